@@ -0,0 +1,191 @@
+#include "include/sista/sista.hpp"
+#include "include/sista/chunked_field.hpp"
+#include "include/fullkning/env.hpp"
+#include "include/fullkning/catalogue.hpp" // Generated by levelpack
+#include "include/fullkning/counters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// bench times the hot paths of the engine and of the game, with the hardware counters of each region when the system allows them
+// bench [--runs N] [--no-counters] [name...] - only the benchmarks whose name contains one of the names
+struct Benchmark {
+    const char* name;
+    std::function<void()> setup; // setup - prepare a run, not measured
+    std::function<std::uint64_t()> run; // run - the measured region, returns the operations it did
+};
+
+struct Result { // The median run of a benchmark
+    std::uint64_t operations = 0;
+    std::uint64_t nanoseconds = 0;
+    counters::Reading reading;
+};
+
+const int FIELD_WIDTH = 400, FIELD_HEIGHT = 300; // Field sizes, bigger than the cache of the pawns' cells
+const int WORLD_SIZE = 4096, WORLD_PAWNS = 100000, WORLD_STEPS = 10;
+const std::size_t GAMES = 1024, GAME_TICKS = 200, ENVS = 4096, ENV_STEPS = 100;
+
+int main(int argc, char* argv[]) {
+    int runs = 5;
+    bool counting = true;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--runs" && i + 1 < argc)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--no-counters")
+            counting = false;
+        else
+            filters.push_back(argument);
+    }
+    std::streambuf* terminal = std::cout.rdbuf();
+    std::ostringstream discarded; // What the fields would print, they're kept silent
+    std::mt19937 random(1);
+
+    // field.swaps - every pawn of a 2/3 full SwappableField moves by one cell, through addPawnToSwap and applySwaps
+    std::unique_ptr<sista::SwappableField> field;
+    std::vector<sista::Pawn*> pawns;
+    // chunked.fall - pawns scattered over a huge ChunkedField fall together, WORLD_STEPS times
+    std::unique_ptr<sista::ChunkedField> world;
+    // rules.tick - games played with random keys, tick after tick
+    std::vector<rules::State> levels = env::levels(level::catalogue);
+    std::vector<rules::State> games;
+    std::vector<unsigned char> keys(GAMES * GAME_TICKS);
+    // env.step - a batch of environments stepped with random actions
+    std::unique_ptr<env::Batch> batch;
+    std::vector<unsigned char> actions(ENVS * ENV_STEPS), observations(ENVS * OBSERVATION), dones(ENVS);
+    std::vector<short> rewards(ENVS);
+
+    std::vector<Benchmark> benchmarks = {
+        {"field.swaps", [&]() {
+            field.reset(new sista::SwappableField(FIELD_WIDTH, FIELD_HEIGHT));
+            field->setDrawing(false);
+            pawns.clear();
+            for (int y = 0; y < FIELD_HEIGHT; y++)
+                for (int x = 0; x < FIELD_WIDTH; x++)
+                    if (random() % 3 != 0) {
+                        pawns.push_back(new sista::Pawn('#', sista::Coordinates(y, x), ANSI::Settings()));
+                        field->addPawn(pawns.back());
+                    }
+        }, [&]() {
+            for (sista::Pawn* pawn : pawns) {
+                sista::Coordinates coordinates = pawn->getCoordinates().saturated((short)(random() % 3) - 1, (short)(random() % 3) - 1, FIELD_WIDTH, FIELD_HEIGHT);
+                field->addPawnToSwap(pawn, coordinates);
+            }
+            field->applySwaps();
+            return (std::uint64_t)pawns.size();
+        }},
+        {"chunked.fall", [&]() {
+            world.reset(new sista::ChunkedField(WORLD_SIZE, WORLD_SIZE));
+            world->setDrawing(false);
+            for (int i = 0; i < WORLD_PAWNS; i++) {
+                sista::Coordinates coordinates(random() % (WORLD_SIZE / 2), random() % WORLD_SIZE);
+                if (world->isFree(coordinates.y, coordinates.x))
+                    world->addPawn(new sista::Pawn('#', coordinates, ANSI::Settings()));
+            }
+        }, [&]() {
+            std::uint64_t moved = 0;
+            for (int step = 0; step < WORLD_STEPS; step++)
+                moved += world->fall([](sista::Pawn*) {
+                    return true;
+                });
+            return moved;
+        }},
+        {"rules.tick", [&]() {
+            games.assign(GAMES, rules::State());
+            for (std::size_t i = 0; i < GAMES; i++)
+                games[i] = levels[i % levels.size()];
+            for (unsigned char& key : keys)
+                key = env::KEYS[random() % 6];
+        }, [&]() {
+            for (std::size_t i = 0; i < GAMES; i++)
+                for (std::size_t t = 0; t < GAME_TICKS; t++) {
+                    if (keys[i * GAME_TICKS + t] != 0)
+                        rules::press(games[i], keys[i * GAME_TICKS + t]);
+                    rules::tick(games[i]);
+                }
+            return (std::uint64_t)(GAMES * GAME_TICKS);
+        }},
+        {"env.step", [&]() {
+            batch.reset(new env::Batch(ENVS, levels, 1, 1000, 1)); // One thread, the counters are of the calling thread
+            for (unsigned char& action : actions)
+                action = random() % 6;
+        }, [&]() {
+            for (std::size_t t = 0; t < ENV_STEPS; t++)
+                batch->step(actions.data() + t * ENVS, observations.data(), rewards.data(), dones.data());
+            return (std::uint64_t)(ENVS * ENV_STEPS);
+        }},
+    };
+
+    counters::Group group;
+    if (counting && !group.isAvailable())
+        std::printf("Hardware counters unavailable, timing only (%s)\n", group.getError().c_str());
+    else if (counting && !group.getError().empty())
+        std::printf("Some hardware counters unavailable (%s)\n", group.getError().c_str());
+    counting = counting && group.isAvailable();
+    std::printf("%-14s %10s %10s", "benchmark", "ops", "ns/op");
+    if (counting)
+        std::printf(" %6s %12s %12s %15s", "IPC", "L1d miss/op", "LLC miss/op", "branch miss/op");
+    std::printf("\n");
+
+    for (Benchmark& benchmark : benchmarks) {
+        bool selected = filters.empty();
+        for (const std::string& filter : filters)
+            selected = selected || std::string(benchmark.name).find(filter) != std::string::npos;
+        if (!selected)
+            continue;
+        std::vector<Result> results;
+        for (int run = 0; run <= runs; run++) { // The first run warms up, it's not kept
+            std::cout.rdbuf(discarded.rdbuf());
+            benchmark.setup();
+            Result result;
+            if (counting)
+                group.start();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            result.operations = benchmark.run();
+            result.nanoseconds = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (counting)
+                result.reading = group.stop();
+            std::cout.rdbuf(terminal);
+            discarded.str("");
+            if (run > 0)
+                results.push_back(result);
+        }
+        std::sort(results.begin(), results.end(), [](const Result& first, const Result& second) {
+            return first.nanoseconds < second.nanoseconds;
+        });
+        const Result& median = results[results.size() / 2];
+        double operations = (double)std::max<std::uint64_t>(1, median.operations);
+        std::printf("%-14s %10llu %10.2f", benchmark.name, (unsigned long long)median.operations, median.nanoseconds / operations);
+        if (counting) {
+            const counters::Reading& reading = median.reading;
+            auto perOperation = [&](counters::Counter counter) {
+                if (reading.valid[counter])
+                    std::printf(" %*.3f", counter == counters::BRANCH_MISSES ? 15 : 12, reading.counts[counter] / operations);
+                else
+                    std::printf(" %*s", counter == counters::BRANCH_MISSES ? 15 : 12, "-");
+            };
+            if (reading.valid[counters::CYCLES] && reading.valid[counters::INSTRUCTIONS] && reading.counts[counters::CYCLES] > 0)
+                std::printf(" %6.2f", (double)reading.counts[counters::INSTRUCTIONS] / reading.counts[counters::CYCLES]);
+            else
+                std::printf(" %6s", "-");
+            perOperation(counters::L1_MISSES);
+            perOperation(counters::LLC_MISSES);
+            perOperation(counters::BRANCH_MISSES);
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+    std::cout.rdbuf(discarded.rdbuf()); // The fields print when they're destroyed too
+    field.reset();
+    world.reset();
+    std::cout.rdbuf(terminal);
+    return 0;
+}
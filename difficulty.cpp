@@ -0,0 +1,225 @@
+#include "include/fullkning/state.hpp"
+#include "include/fullkning/level.hpp"
+#include "include/fullkning/solver.hpp"
+#include "include/fullkning/env.hpp"
+#include "include/fullkning/catalogue.hpp" // Generated by levelpack
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// difficulty estimates how hard the levels are, from many playouts of the rules by a policy on all the cores
+// The policy is the solver with a chance epsilon of a random action at each step (or only random actions), so the levels
+// which punish a mistake the most are the hardest; the playouts stop once the confidence intervals are tight enough
+// difficulty [--policy heuristic|random] [--epsilon E] [--limit TICKS] [--precision P] [--score-precision S] [--max N] [--seed S] [--threads N] [level...]
+// A level is the name of a built-in level or of levels/{name}.level, or a directory of .level files; all the built-in levels by default
+const unsigned BATCH = 64; // Playouts of a batch, from the same generator
+const unsigned BATCHES = 64; // Batches of a round, the intervals are checked at its end
+
+struct Options {
+    bool random = false; // random - only random actions, instead of the solver's
+    double epsilon = 0.05; // epsilon - chance of a random action at each step
+    unsigned limit = 2000; // limit - ticks after which a playout is lost
+    double precision = 0.01; // precision - half width of the interval of the completion rate
+    double scorePrecision = 0.25; // scorePrecision - half width of the interval of the mean score of the wins
+    std::uint64_t most = 1000000; // most - playouts of a level at most
+    std::uint64_t seed = 1;
+    unsigned threads = 1;
+};
+
+struct Tally { // Tally - the outcomes of some playouts of a level
+    std::uint64_t playouts = 0, wins = 0;
+    double scores = 0, squares = 0; // scores, squares - sum of the scores of the wins, and of their squares
+    std::uint64_t moves = 0, ticks = 0; // moves, ticks - keys pressed and ticks of the wins
+    std::vector<std::uint64_t> histogram; // histogram[score - lowest] - wins with the score
+
+    void add(const Tally& other) {
+        playouts += other.playouts, wins += other.wins;
+        scores += other.scores, squares += other.squares;
+        moves += other.moves, ticks += other.ticks;
+        histogram.resize(std::max(histogram.size(), other.histogram.size()), 0);
+        for (std::size_t i = 0; i < other.histogram.size(); i++)
+            histogram[i] += other.histogram[i];
+    }
+};
+
+std::uint64_t xorshift(std::uint64_t& x) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    return x;
+}
+
+// playouts - BATCH playouts of the level from its start, each a copy of it, with the generator of the batch
+// Each step is an action then a tick, as in env::Batch
+void playouts(const rules::State& start, const Options& options, std::uint64_t random, int lowest, Tally& tally) {
+    tally = Tally();
+    tally.histogram.assign((std::size_t)(start.score - lowest + 1), 0);
+    for (unsigned i = 0; i < BATCH; i++) {
+        rules::State game = start;
+        std::uint64_t moves = 0;
+        while (!rules::victory(game) && game.ticks < options.limit) {
+            char key;
+            if (options.random || (double)(xorshift(random) >> 11) * 0x1.0p-53 < options.epsilon)
+                key = env::KEYS[xorshift(random) % 6];
+            else
+                key = solver::next(game);
+            if (key != 0) {
+                rules::press(game, key);
+                moves++;
+            }
+            rules::tick(game);
+            if (solver::isStuck(game)) // It's lost, no need to play it out
+                break;
+        }
+        tally.playouts++;
+        if (!rules::victory(game))
+            continue;
+        tally.wins++;
+        tally.scores += game.score, tally.squares += (double)game.score * game.score;
+        tally.moves += moves, tally.ticks += game.ticks;
+        tally.histogram[(std::size_t)(game.score - lowest)]++;
+    }
+}
+
+// wilson - half width and center of the 95% Wilson interval of a rate
+void wilson(std::uint64_t successes, std::uint64_t trials, double& center, double& half) {
+    const double z = 1.96;
+    double n = (double)trials, p = successes / n;
+    double denominator = 1 + z*z / n;
+    center = (p + z*z / (2*n)) / denominator;
+    half = z * std::sqrt(p*(1 - p) / n + z*z / (4*n*n)) / denominator;
+}
+
+int percentile(const Tally& tally, int lowest, double fraction) { // percentile - the score of the wins which fraction of them don't exceed
+    std::uint64_t rank = (std::uint64_t)std::ceil(fraction * tally.wins), seen = 0;
+    for (std::size_t i = 0; i < tally.histogram.size(); i++)
+        if ((seen += tally.histogram[i]) >= std::max<std::uint64_t>(rank, 1))
+            return lowest + (int)i;
+    return lowest + (int)tally.histogram.size() - 1;
+}
+
+// estimate - play the level round after round until the intervals are tight enough, and print its line
+// The generator of each batch comes from the seed, the name of the level and the batch, so the figures don't depend on the threads
+void estimate(const std::string& name, const rules::State& start, const Options& options) {
+    std::uint64_t level = 0xCBF29CE484222325ull; // FNV-1a of the name
+    for (char c : name)
+        level = (level ^ (unsigned char)c) * 0x100000001B3ull;
+    int lowest = start.score - (int)(options.limit / COOLDOWN + 1); // An unhook each COOLDOWN ticks at most
+    Tally total;
+    total.histogram.assign((std::size_t)(start.score - lowest + 1), 0);
+    std::vector<Tally> tallies(BATCHES);
+    double center = 0, rateHalf = 1, mean = 0, meanHalf = 0;
+    for (std::uint64_t round = 0; total.playouts < options.most; round++) {
+        std::atomic<unsigned> next(0);
+        std::vector<std::thread> workers;
+        for (unsigned thread = 0; thread < std::min(options.threads, BATCHES); thread++)
+            workers.emplace_back([&]() {
+                for (unsigned batch = next++; batch < BATCHES; batch = next++) {
+                    std::uint64_t random = (options.seed * 0x9E3779B97F4A7C15ull) ^ level ^ ((round * BATCHES + batch + 1) * 0x94D049BB133111EBull);
+                    random |= 1; // Never 0, which xorshift can't leave
+                    xorshift(random);
+                    playouts(start, options, random, lowest, tallies[batch]);
+                }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+        for (const Tally& tally : tallies)
+            total.add(tally);
+        wilson(total.wins, total.playouts, center, rateHalf);
+        if (total.wins > 1) {
+            mean = total.scores / total.wins;
+            double variance = std::max(0.0, (total.squares - total.wins * mean * mean) / (total.wins - 1));
+            meanHalf = 1.96 * std::sqrt(variance / total.wins);
+        }
+        if (rateHalf <= options.precision && (total.wins < 2 || meanHalf <= options.scorePrecision))
+            break;
+    }
+    double wins = (double)std::max<std::uint64_t>(1, total.wins);
+    std::printf("%s,%u,%u,%d,%llu,%.4f,%.4f,%.4f,", name.c_str(), (unsigned)start.targets, solver::stones(start), (int)solver::best(start),
+        (unsigned long long)total.playouts, (double)total.wins / total.playouts, std::max(0.0, center - rateHalf), std::min(1.0, center + rateHalf));
+    if (total.wins == 0)
+        std::printf(",,,,,,\n");
+    else
+        std::printf("%.3f,%.3f,%d,%d,%d,%.2f,%.2f\n", mean, meanHalf, percentile(total, lowest, 0.1), percentile(total, lowest, 0.5),
+            percentile(total, lowest, 0.9), total.moves / wins, total.ticks / wins);
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool valid = i + 1 < argc;
+        if (argument == "--policy" && valid)
+            options.random = std::string(argv[++i]) == "random", valid = options.random || std::string(argv[i]) == "heuristic";
+        else if (argument == "--epsilon" && valid)
+            options.epsilon = std::atof(argv[++i]);
+        else if (argument == "--limit" && valid)
+            options.limit = (unsigned)std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--precision" && valid)
+            options.precision = std::atof(argv[++i]);
+        else if (argument == "--score-precision" && valid)
+            options.scorePrecision = std::atof(argv[++i]);
+        else if (argument == "--max" && valid)
+            options.most = std::max<std::uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if (argument == "--seed" && valid)
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--threads" && valid)
+            options.threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        else if (argument.rfind("--", 0) != 0)
+            names.push_back(argument), valid = true;
+        else
+            valid = false;
+        if (!valid) {
+            std::cerr << "Usage: difficulty [--policy heuristic|random] [--epsilon E] [--limit TICKS] [--precision P] [--score-precision S] [--max N] [--seed S] [--threads N] [level...]" << std::endl;
+            return 1;
+        }
+    }
+    if (names.empty())
+        for (const level::Embedded& embedded : level::catalogue)
+            names.push_back(embedded.name);
+
+    // The levels, the directories are expanded into their .level files
+    std::vector<std::pair<std::string, std::string>> levels; // (name, path of the file, empty for a built-in level)
+    for (const std::string& name : names) {
+        std::error_code error;
+        if (std::filesystem::is_directory(name, error)) {
+            std::vector<std::string> files;
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(name, error))
+                if (entry.is_regular_file() && entry.path().extension() == ".level")
+                    files.push_back(entry.path().string());
+            std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) { // Numeric names in order
+                return a.size() != b.size() ? a.size() < b.size() : a < b;
+            });
+            for (const std::string& file : files)
+                levels.emplace_back(std::filesystem::path(file).stem().string(), file);
+        } else {
+            levels.emplace_back(name, level::findEmbedded(level::catalogue, name.c_str()) != nullptr ? "" : "levels/" + name + ".level");
+        }
+    }
+
+    std::printf("level,targets,stones,best_score,playouts,completion,completion_low,completion_high,score_mean,score_ci,score_p10,score_p50,score_p90,moves_mean,ticks_mean\n");
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        rules::State start; // Each playout starts from a copy of it, a memcpy
+        try {
+            if (levels[i].second.empty())
+                rules::start(start, level::fromEmbedded(*level::findEmbedded(level::catalogue, levels[i].first.c_str())));
+            else
+                rules::start(start, level::parseFile(levels[i].second, WIDTH, HEIGHT, 2)); // Rows 0 and 1 belong to the builder
+        } catch (std::runtime_error& e) {
+            std::cerr << "Error while loading the level " << levels[i].first << ": " << e.what() << std::endl;
+            return 1;
+        }
+        estimate(levels[i].first, start, options);
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+
+// fullklag measures how long the keys of fullkning take to show up: it plays a scripted game in a pseudo-terminal
+// with FULLKNING_LATENCY set (see latency.hpp), reading the output as fast as a terminal would, then prints the report
+// The game is run without FULLKNING_SAVE, so quitting it leaves no save behind
+// fullklag [--game PATH] [--report PATH] [--interval MS] [--size ROWSxCOLUMNS] [keys] [level]
+// keys - a key of the game for each character, '.' for a pause, one every interval; q is sent at the end
+#ifdef _WIN32
+int main() {
+    std::cerr << "fullklag needs a pseudo-terminal, it's not available on Windows" << std::endl;
+    return 1;
+}
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+const char* const KEYS = "dddd.s...aaaa.w.s...dd .s...ddddd.aa.s...w.aaa.s..."; // Moves, unhooks, selections and stops
+
+void pause(int milliseconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+int main(int argc, char* argv[]) {
+    std::string game = "./fullkning", report = "latency.csv", keys = KEYS, level = "1";
+    int interval = 100, rows = 40, columns = 120, positional = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--game" && i + 1 < argc)
+            game = argv[++i];
+        else if (argument == "--report" && i + 1 < argc)
+            report = argv[++i];
+        else if (argument == "--interval" && i + 1 < argc)
+            interval = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--size" && i + 1 < argc && std::sscanf(argv[i + 1], "%dx%d", &rows, &columns) == 2)
+            i++;
+        else if (positional++ == 0)
+            keys = argument;
+        else
+            level = argument;
+    }
+
+    int terminal = posix_openpt(O_RDWR | O_NOCTTY);
+    if (terminal < 0 || grantpt(terminal) < 0 || unlockpt(terminal) < 0) {
+        std::cerr << "No pseudo-terminal could be opened: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string name = ptsname(terminal);
+    winsize size = {(unsigned short)rows, (unsigned short)columns, 0, 0};
+    ioctl(terminal, TIOCSWINSZ, &size);
+    std::remove(report.c_str());
+    pid_t pid = fork();
+    if (pid == 0) { // The game, with the pseudo-terminal as its controlling terminal
+        setsid();
+        int slave = open(name.c_str(), O_RDWR);
+        #ifdef TIOCSCTTY
+            ioctl(slave, TIOCSCTTY, 0);
+        #endif
+        dup2(slave, 0), dup2(slave, 1), dup2(slave, 2);
+        close(slave);
+        close(terminal);
+        setenv("FULLKNING_LATENCY", report.c_str(), 1);
+        unsetenv("FULLKNING_SAVE"); // A scripted game is never resumed, nor saved
+        execl(game.c_str(), game.c_str(), level.c_str(), (char*)nullptr);
+        std::perror(("fullklag: " + game).c_str());
+        _exit(127);
+    }
+
+    // The output is read as soon as it's written, a terminal that is never behind
+    // The reader stops at the end of the output (EOF or EIO once the game exited), or when nothing comes after stopping is set
+    std::atomic<std::uint64_t> output(0);
+    std::atomic<bool> stopping(false);
+    std::thread reader([terminal, &output, &stopping]() {
+        char buffer[65536];
+        while (true) {
+            pollfd pseudo = {terminal, POLLIN, 0};
+            int ready = poll(&pseudo, 1, 100);
+            if (ready < 0 && errno != EINTR)
+                return;
+            if (ready <= 0) {
+                if (stopping.load())
+                    return;
+                continue;
+            }
+            ssize_t received = read(terminal, buffer, sizeof(buffer));
+            if (received > 0)
+                output.fetch_add((std::uint64_t)received, std::memory_order_relaxed);
+            else if (received == 0 || errno != EINTR)
+                return;
+        }
+    });
+
+    pause(1500); // The game shows the level for a second before it reads the keys
+    std::size_t sent = 0;
+    for (char key : keys + "q") {
+        if (key != '.') {
+            if (write(terminal, &key, 1) != 1)
+                break;
+            sent++;
+        }
+        pause(interval);
+    }
+    pause(500);
+    if (write(terminal, "\n", 1) != 1) // The game waits for a key before it exits
+        std::cerr << "The game could not be sent its last key" << std::endl;
+    int status = 0;
+    for (int waited = 0; waitpid(pid, &status, WNOHANG) == 0; waited += 10) {
+        if (waited >= 5000) { // It's stuck
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            break;
+        }
+        pause(10);
+    }
+    stopping = true; // The game is gone, the reader takes what's left of its output and stops
+    reader.join();
+    close(terminal); // Only once the reader can't be reading it
+
+    std::ifstream file(report);
+    if (!file) {
+        std::cerr << "The game wrote no report to " << report << " (is " << game << " fullkning?)" << std::endl;
+        return 1;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::cout << "Sent " << sent << " keys, read " << output.load() << " bytes of output" << std::endl << contents.str();
+    return 0;
+}
+#endif
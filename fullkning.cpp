@@ -1,9 +1,25 @@
 #include "include/sista/sista.hpp"
-#include <algorithm>
-#include <fstream>
+#include "include/fullkning/level.hpp"
+#include "include/fullkning/state.hpp"
+#include "include/fullkning/history.hpp"
+#include "include/fullkning/frame.hpp"
+#include "include/fullkning/triple_buffer.hpp"
+#include "include/fullkning/telemetry.hpp"
+#include "include/fullkning/trace.hpp"
+#include "include/fullkning/stats.hpp"
+#include "include/fullkning/allocations.hpp"
+#include "include/fullkning/spectate.hpp"
+#include "include/fullkning/latency.hpp"
+#ifndef FULLKNING_NO_EMBEDDED_LEVELS
+    #include "include/fullkning/catalogue.hpp" // Generated by levelpack
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 #include <chrono>
 #include <thread>
 #include <future>
+#include <atomic>
 #ifdef _WIN32
     #include <windows.h>
 #endif
@@ -50,12 +66,6 @@
     }
 #endif
 
-#define WIDTH 10
-#define HEIGHT 20
-#define COOLDOWN 3
-
-sista::Coordinates one_down(1, 0);
-
 ANSI::Settings description_style(
     ANSI::ForegroundColor::F_WHITE,
     ANSI::BackgroundColor::B_BLACK,
@@ -82,205 +92,54 @@ ANSI::Settings builder_style(
     ANSI::Attribute::REVERSE
 );
 
-enum class BlockType {
-    Virtual,
-    Sand,
-    Stone
-};
-
-// Block will be a layer between the Pawn class and the actual blocks, just to differentiate them
-class Block : public sista::Pawn {
-protected:
-    BlockType type;
-public:
-    Block(char symbol_, sista::Coordinates coordinates_, ANSI::Settings settings_, BlockType type_): sista::Pawn(symbol_, coordinates_, settings_), type(type_) {}
-    Block(char symbol_, sista::Coordinates& coordinates_, ANSI::Settings& settings_, BlockType type_, bool _by_reference): sista::Pawn(symbol_, coordinates_, settings_), type(type_) {}
-    virtual BlockType getType() {
-        return type;
-    }
-};
-
-// A SandBlock represents a block that falls until it finds another block or the ground
-class SandBlock : public Block {
-public:
-    bool shadowing_virtual = false; // This will tell if the Block is over a VirtualBlock
-
-    SandBlock(sista::Coordinates coordinates_) : Block('#', coordinates_, sand_style, BlockType::Sand) {}
-    SandBlock(sista::Coordinates& coordinates_, bool _by_reference) : Block('#', coordinates_, sand_style, BlockType::Sand, true) {}
-    virtual BlockType getType() {
-        return BlockType::Sand;
-    }
-};
-// A StoneBlock represents a block that cannot fall once it's been placed
-class StoneBlock : public Block {
-public:
-    bool shadowing_virtual = false; // This will tell if the Block is over a VirtualBlock
-
-    StoneBlock(sista::Coordinates coordinates_) : Block('#', coordinates_, stone_style, BlockType::Stone) {}
-    StoneBlock(sista::Coordinates& coordinates_, bool _by_reference) : Block('#', coordinates_, stone_style, BlockType::Stone, true) {}
-    virtual BlockType getType() {
-        return BlockType::Stone;
-    }
-};
-// A VirtualBlock represents the place where the user will have to collocate the blocks
-class VirtualBlock : public Block {
-public:
-    VirtualBlock(sista::Coordinates coordinates_) : Block((char)('0'+coordinates_.x), coordinates_, virtual_style, BlockType::Virtual) {}
-    VirtualBlock(sista::Coordinates& coordinates_, bool _by_reference) : Block((char)('0'+coordinates_.x), coordinates_, virtual_style, BlockType::Virtual, true) {}
-    virtual BlockType getType() {
-        return BlockType::Virtual;
-    }
-};
-
-// This class will be used to create the builder, that one which unhooks the blocks
-class Builder : public sista::Pawn {
-public:
-    Builder(sista::Coordinates coordinates_) : Pawn('$', coordinates_, builder_style) {}
-    Builder(sista::Coordinates& coordinates_, bool _by_reference) : Pawn('$', coordinates_, builder_style) {}
-
-    void unhook();
-};
-
 // This namespace will contain all that ugly global variables
 namespace game {
-    Builder* builder; // Global variable which will be used as a pointer to the builder
-    sista::Field* field; // Global variable which will be used as a pointer to the field
-    short int score = 0; // Global variable which will be used to store the score
-    bool stone_enabled = true; // This will tell if there's no more stone falling, so you can unhook another
-    short int frame_countdown = 0; // This will tell when the builder will be able to unhook another block
-    BlockType hooked_block = BlockType::Sand; // This will tell which block the user has selected
-    StoneBlock* stone_falling = nullptr; // This will point to the stone which is currently falling
-    std::vector<SandBlock*> sand_falling; // This will contain all the sand blocks which are currently falling
-    std::vector<sista::Coordinates*> targets; // This will contain all the coordinates of the virtual blocks
-}
-
-// This function will be called when the builder will unhook a block
-void Builder::unhook() {
-    // As the first thing, we must check if the frame_countdown is 0 or less, otherwise we can't unhook
-    if (game::frame_countdown <= 0) {
-        sista::Coordinates coordinates = this->getCoordinates(); // We get the coordinates of the builder
-        coordinates.y++; // We move the coordinates one block down
-        if (game::hooked_block == BlockType::Sand) { // If we have to unhook Sand...
-            game::sand_falling.push_back(new SandBlock(coordinates)); // We create a new SandBlock
-            game::field->addPrintPawn(game::sand_falling.back()); // We add the SandBlock to the field
-        } else if (game::hooked_block == BlockType::Stone) { // If we have to unhook Stone...
-            if (game::stone_enabled) { // If we can unhook Stone...
-                game::stone_falling = new StoneBlock(coordinates); // We create a new StoneBlock
-                game::field->addPrintPawn(game::stone_falling); // We add the StoneBlock to the field
-                game::stone_enabled = false; // We disable the stone unhooking
-            } else {
-                // If we can't unhook Stone, we just return
-                return;
-            }
-        }
-        game::score--; // We decrement the score
-        game::frame_countdown = COOLDOWN; // We reset the frame_countdown
-    }
+    sista::Viewport* viewport; // Global variable which will be used as a pointer to the visible part of the field
+    rules::State state; // The whole game, the screen is drawn from it
+    rules::State beginning; // The level as it was at its beginning, for the instant restart
+    rules::History history; // The moves which can be undone
+    std::string save_path; // Where the game is saved when the user quits, to be resumed the next time, empty if it isn't (see FULLKNING_SAVE)
+    std::string telemetry_path; // Where the timings of the phases are reported, empty if they aren't (see FULLKNING_TELEMETRY)
+    std::string latency_path; // Where the latency of the keys is reported, empty if it isn't measured (see FULLKNING_LATENCY)
+    stats::Publisher stats; // The live counters for fullkstat, if FULLKNING_STATS is set
+    std::atomic<std::uint64_t> output_bytes(0); // Bytes the terminal took from the render thread (not the ones still waiting for it)
+    bool accounting = false; // If the allocations are shown in the HUD and summed up at exit (see FULLKNING_ALLOCATIONS)
+    std::uint64_t ticks = 0; // Ticks since the game started, restarts and undos included
 }
 
-// This function will move all the sand blocks which are currently falling
-void moveAllSandBlocks() {
-    std::queue<SandBlock*> to_remove; // This will contain all the sand blocks which have reached the ground
-    for (SandBlock*& sand_block : game::sand_falling) {
-        try {
-            game::field->movePawnBy(sand_block, one_down);
-            if (sand_block->shadowing_virtual) {
-                // If the sand block is shadowing a VirtualBlock
-                sista::Coordinates coordinates = sand_block->getCoordinates();
-                coordinates.y--; // We move the coordinates one block up
-                game::field->addPrintPawn(new VirtualBlock(coordinates)); // We add a new VirtualBlock to the field
-                sand_block->shadowing_virtual = false; // We disable the shadowing
-            }
-        } catch (std::out_of_range& e) {
-            // If the sand block has reached the ground, we add it to the queue
-            to_remove.push(sand_block);
-        } catch (std::invalid_argument& e) {
-            // In this case we actually have to check if the sand block has reached another concrete Block or if it has reached a VirtualBlock
-            sista::Coordinates coordinates = sand_block->getCoordinates();
-            coordinates.y++;
-            BlockType type = ((Block*)game::field->getPawn(coordinates))->getType();
-            if (type == BlockType::Sand || type == BlockType::Stone) {
-                // If the sand block has reached a SandBlock or a StoneBlock, we add it to the queue
-                to_remove.push(sand_block);
-            } else if (type == BlockType::Virtual) {
-                // If the sand block has reached a VirtualBlock... well, here it comes the hard part...
-                if (sand_block->shadowing_virtual) {
-                    game::field->removePawn(sand_block); // We remove the sand block from the field
-                    game::field->movePawnFromTo(coordinates.y, coordinates.x, coordinates.y - 1, coordinates.x); // We move the VirtualBlock one block up (smart swap)
-                    game::field->addPrintPawn(game::field->getPawn(coordinates.y - 1, coordinates.x)); // We add the VirtualBlock to the field
-                    sand_block->setCoordinates(coordinates); // We set the coordinates of the sand block to the new ones
-                    game::field->addPrintPawn(sand_block); // We add the sand block to the field
-                } else {
-                    sand_block->shadowing_virtual = true; // We set the shadowing_virtual to true
-                    // Now we remove the VirtualBlock from the field and we replace it with the SandBlock
-                    game::field->removePawn(game::field->getPawn(coordinates));
-                    game::field->movePawnBy(sand_block, one_down);
-                    // game::field->addPrintPawn(sand_block);
-                }
-            }
-        }
-    }
-    // Now we remove all the sand blocks which have reached the ground
-    while (!to_remove.empty()) {
-        SandBlock* block = to_remove.front();
-        game::sand_falling.erase(std::find(game::sand_falling.begin(), game::sand_falling.end(), block));
-        to_remove.pop();
-    }
-}
-void moveStoneBlock() {
-    if (game::stone_falling == nullptr) {
-        // If there is no stone block falling, we just return
-        return;
-    }
+std::vector<sista::Coordinates> loadLevelFile(std::string path) {
     try {
-        game::field->movePawnBy(game::stone_falling, one_down);
-        if (game::stone_falling->shadowing_virtual) {
-            // If the stone block is shadowing a VirtualBlock
-            sista::Coordinates coordinates = game::stone_falling->getCoordinates();
-            coordinates.y--; // We move the coordinates one block up
-            game::field->addPrintPawn(new VirtualBlock(coordinates)); // We add a new VirtualBlock to the field
-            game::stone_falling->shadowing_virtual = false; // We disable the shadowing
-        }
-    } catch (std::out_of_range& e) {
-        // If the stone block has reached the ground, it's no more falling
-        game::stone_falling = nullptr;
-        game::stone_enabled = true;
-    } catch (std::invalid_argument& e) {
-        // In this case we actually have to check if the stone block has reached another concrete Block or if it has reached a VirtualBlock
-        sista::Coordinates coordinates = game::stone_falling->getCoordinates();
-        coordinates.y++;
-        BlockType type = ((Block*)game::field->getPawn(coordinates))->getType();
-        if (type == BlockType::Sand || type == BlockType::Stone) {
-            // If the stone block has reached a SandBlock or a StoneBlock, we add it to the queue
-            game::stone_falling = nullptr;
-            game::stone_enabled = true;
-        } else if (type == BlockType::Virtual) {
-            // If the stone block has reached a VirtualBlock... well, here it comes the hard part...
-            if (game::stone_falling->shadowing_virtual) {
-                game::field->removePawn(game::stone_falling); // We remove the stone block from the field
-                game::field->movePawnFromTo(coordinates.y, coordinates.x, coordinates.y - 1, coordinates.x); // We move the VirtualBlock one block up (smart swap)
-                game::field->addPrintPawn(game::field->getPawn(coordinates.y - 1, coordinates.x)); // We add the VirtualBlock to the field
-                game::stone_falling->setCoordinates(coordinates); // We set the coordinates of the stone block to the new ones
-                game::field->addPrintPawn(game::stone_falling); // We add the stone block to the field
-            } else {
-                game::stone_falling->shadowing_virtual = true; // We set the shadowing_virtual to true
-                // Now we remove the VirtualBlock from the field and we replace it with the SandBlock
-                game::field->removePawn(game::field->getPawn(coordinates));
-                game::field->movePawnBy(game::stone_falling, one_down);
-                // game::field->addPrintPawn(game::stone_falling);
-            }
-        }
+        return level::parseFile(path, WIDTH, HEIGHT, 2); // Rows 0 and 1 belong to the builder
+    } catch (std::runtime_error& e) { // Both a missing file and a level::ParseError
+        std::cerr << "Error while loading the level " << path << ": " << e.what() << std::endl;
+        #if defined(_WIN32) or defined(__linux__)
+            getch();
+        #elif __APPLE__
+            getchar();
+        #endif
+        exit(1);
     }
 }
-void stopStoneFalling() {
-    game::stone_falling = nullptr;
-    game::stone_enabled = true;
+std::vector<sista::Coordinates> loadLevel(std::string name) {
+    #ifndef FULLKNING_NO_EMBEDDED_LEVELS
+        const level::Embedded* embedded = level::findEmbedded(level::catalogue, name.c_str());
+        if (embedded != nullptr) // Built-in levels are loaded straight from static data
+            return level::fromEmbedded(*embedded);
+    #endif
+    return loadLevelFile("levels/" + name + ".level"); // Unknown levels are looked for on the disk
 }
-
-void fillFromLevelFile(std::string path) {
-    std::ifstream file(path, std::ios::in);
-    if (!file.is_open()) {
-        std::cerr << "Error while opening the file " << path << std::endl;
+// This function will start the level, or resume it if it was saved when the user quit (only if FULLKNING_SAVE is set)
+void startLevel(std::string name) {
+    allocations::Tag tag(allocations::LEVEL);
+    rules::start(game::beginning, loadLevel(name));
+    game::state = game::beginning;
+    if (std::getenv("FULLKNING_SAVE") == nullptr)
+        return; // Without it a built-in level never touches the disk
+    game::save_path = "levels/" + name + ".save";
+    try {
+        rules::load(game::state, game::save_path);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error while resuming the level from " << game::save_path << ": " << e.what() << " (delete it to start the level again)" << std::endl;
         #if defined(_WIN32) or defined(__linux__)
             getch();
         #elif __APPLE__
@@ -288,27 +147,127 @@ void fillFromLevelFile(std::string path) {
         #endif
         exit(1);
     }
-    unsigned int y, x;
-    while (file >> y >> x) {
-        game::targets.push_back(new sista::Coordinates(y, x));
-        game::field->addPawn(new VirtualBlock(*game::targets.back()));
-    }
-    file.close();
-    game::score = game::targets.size() * 3;
 }
 
+render::Cell styledCell(char symbol, ANSI::Settings& settings) {
+    render::Cell cell;
+    cell.symbol = symbol;
+    cell.foreground = settings.foregroundColor;
+    cell.background = settings.backgroundColor;
+    cell.attribute = settings.attribute;
+    return cell;
+}
+render::Cell drawCell(unsigned short y, unsigned short x) { // What the cell [y][x] of the game looks like
+    if (y == 1 && x == game::state.builder)
+        return styledCell('$', builder_style);
+    unsigned char cell = game::state.cells[y][x];
+    if ((cell & rules::BLOCK) == rules::SAND)
+        return styledCell('#', sand_style);
+    if ((cell & rules::BLOCK) == rules::STONE)
+        return styledCell('#', stone_style);
+    if (cell == rules::TARGET)
+        return styledCell((char)('0' + x), virtual_style);
+    return render::Cell();
+}
+
+// This function will make the blocks which are due fall, as rules::tick does, timing each phase
+void tick() {
+    allocations::Tag tag(allocations::PHYSICS);
+    game::ticks++;
+    unsigned short due[rules::Timers::SIZE];
+    unsigned char count;
+    {
+        telemetry::Scope scope(telemetry::SAND);
+        count = rules::advance(game::state, due);
+        rules::fallSand(game::state, due, count);
+    }
+    #ifdef FULLKNING_TRACE
+        short stone = game::state.stone;
+        for (unsigned char i = 0; i < count; i++) // A released timer wasn't scheduled again, so its due tick is now
+            if (game::state.timers.get(due[i]).block == rules::SAND && game::state.timers.getDue(due[i]) == game::state.timers.getNow())
+                trace::instant("landing", game::state.timers.get(due[i]).cell);
+    #endif
+    {
+        telemetry::Scope scope(telemetry::STONE);
+        rules::fallStone(game::state, due, count);
+    }
+    #ifdef FULLKNING_TRACE
+        if (stone >= 0 && game::state.stone < 0)
+            trace::instant("landing", stone);
+    #endif
+}
 bool victory() {
-    for (sista::Coordinates* coordinates : game::targets) {
-        if (game::field->getPawn(*coordinates) == nullptr)
-            continue;
-        if (((Block*)game::field->getPawn(*coordinates))->getType() == BlockType::Virtual)
-            return false;
+    telemetry::Scope scope(telemetry::VICTORY);
+    return rules::victory(game::state);
+}
+// This function will write the timeline, if the game was compiled with FULLKNING_TRACE
+void dumpTrace() {
+    #ifdef FULLKNING_TRACE
+        const char* path = std::getenv("FULLKNING_TRACE_FILE");
+        try {
+            trace::dump(path != nullptr ? path : "trace.json");
+        } catch (std::runtime_error& e) {
+            std::cerr << "The trace could not be written: " << e.what() << std::endl;
+        }
+    #endif
+}
+// This function will write the timings of the phases, if they were asked for
+void reportTelemetry() {
+    if (game::telemetry_path.empty())
+        return;
+    telemetry::Table table; // The allocations by subsystem, per tick too
+    #ifndef FULLKNING_NO_ALLOCATIONS
+        table.name = "allocations";
+        table.columns = {"allocations", "frees", "bytes", "live_bytes", "peak_bytes", "allocations_per_tick", "bytes_per_tick"};
+        double ticks = (double)std::max<std::uint64_t>(1, game::ticks);
+        for (unsigned subsystem = 0; subsystem < allocations::SUBSYSTEMS; subsystem++) {
+            const allocations::Account& account = allocations::accounts[subsystem];
+            double counts[] = {(double)account.allocations.load(), (double)account.frees.load(), (double)account.bytes.load(), (double)account.live.load(), (double)account.peak.load()};
+            table.rows.emplace_back(allocations::NAMES[subsystem], std::vector<double>{counts[0], counts[1], counts[2], counts[3], counts[4], std::round(counts[0] / ticks * 1000) / 1000, std::round(counts[2] / ticks * 1000) / 1000});
+        }
+    #endif
+    try {
+        telemetry::report(game::telemetry_path, table);
+    } catch (std::runtime_error& e) {
+        std::cerr << "The telemetry could not be written to " << game::telemetry_path << ": " << e.what() << std::endl;
+    }
+}
+// This function will write the latency of the keys, if it was measured
+void reportLatency() {
+    if (game::latency_path.empty())
+        return;
+    try {
+        latency::report(game::latency_path);
+    } catch (std::runtime_error& e) {
+        std::cerr << "The latency could not be written to " << game::latency_path << ": " << e.what() << std::endl;
     }
-    return true;
 }
 
-inline void changeBlockType() {
-    game::hooked_block = game::hooked_block == BlockType::Sand ? BlockType::Stone : BlockType::Sand;
+// This function will publish the state of the game as a new frame for the render thread
+void publishFrame(TripleBuffer<render::Frame>& frames, std::chrono::steady_clock::time_point start) {
+    telemetry::Scope scope(telemetry::CAPTURE);
+    allocations::Tag tag(allocations::RENDERING);
+    render::Frame& frame = frames.getBack();
+    frame.top = game::viewport->getTop();
+    frame.left = game::viewport->getLeft();
+    frame.rows = game::viewport->getRows();
+    frame.columns = game::viewport->getColumns();
+    frame.cells.resize((std::size_t)frame.rows * frame.columns); // The capacity is kept between frames
+    render::Cell* cell = frame.cells.data();
+    for (unsigned short y = frame.top; y < frame.top + frame.rows; y++)
+        for (unsigned short x = frame.left; x < frame.left + frame.columns; x++)
+            *(cell++) = drawCell(y, x);
+    frame.time = std::chrono::duration_cast<std::chrono::duration<int, std::milli>>(std::chrono::steady_clock::now() - start).count();
+    frame.score = game::state.score;
+    frame.targets = game::state.targets;
+    frame.cooldown = (short)rules::cooldown(game::state);
+    frame.stone = game::state.stoneSelected;
+    frame.heap = game::accounting;
+    frame.heapLive = allocations::getLive();
+    frame.heapPeak = allocations::getPeak();
+    frame.keys = latency::capture();
+    if (!frames.publish()) // The render thread is behind, the previous frame was dropped before it could take it
+        telemetry::dropped.fetch_add(1, std::memory_order_relaxed);
 }
 
 int main(int argc, char* argv[]) {
@@ -328,97 +287,172 @@ int main(int argc, char* argv[]) {
         term_echooff();
     #endif
     sista::Cursor cursor;
-    sista::Field field_(WIDTH, HEIGHT); // [normally the scheme is [y][x], this is an exception in Sista]
-    game::field = &field_;
-    game::builder = new Builder(sista::Coordinates(1, 5));
-    field_.addPawn(game::builder);
-    field_.print('&');
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    sista::clearScreen();
-    std::string path = "levels/";
-    path += argc > 1 ? argv[1] : "1";
-    path += ".level";
-    fillFromLevelFile(path);
-    field_.print('&');
-    ANSI::Settings(
-        ANSI::ForegroundColor::F_WHITE,
-        ANSI::BackgroundColor::B_BLACK,
-        ANSI::Attribute::REVERSE
-    ).apply();
-    cursor.set(2, 2);
-    std::cout << "0123456789" << std::flush;
-    cursor.set(2 + HEIGHT + 1, 2);
-    std::cout << "0123456789" << std::flush;
-    ANSI::reset();
+    sista::Viewport viewport(WIDTH, HEIGHT, 5, 30); // Border and rulers take 5 rows, border and HUD take 30 columns
+    game::viewport = &viewport;
+    #ifndef FULLKNING_NO_ALLOCATIONS
+        game::accounting = std::getenv("FULLKNING_ALLOCATIONS") != nullptr;
+    #endif
+    startLevel(argc > 1 ? argv[1] : "1");
+    const char* telemetry_path = std::getenv("FULLKNING_TELEMETRY");
+    game::telemetry_path = telemetry_path != nullptr ? telemetry_path : "";
+    const char* latency_path = std::getenv("FULLKNING_LATENCY");
+    game::latency_path = latency_path != nullptr ? latency_path : "";
+    latency::enabled = latency_path != nullptr;
+    telemetry::listen();
+    if (std::getenv("FULLKNING_STATS") != nullptr && !game::stats.open())
+        std::cerr << "The live stats could not be published in shared memory" << std::endl;
+    viewport.update(sista::Coordinates(1, game::state.builder));
+
+    // The field is printed by the render thread, so a slow terminal can't delay the ticks
+    TripleBuffer<render::Frame> frames;
+    std::atomic<bool> rendering(true);
+    spectate::Server spectators; // The spectators, if FULLKNING_SPECTATE is set, get the frames the terminal gets
+    const char* spectate_path = std::getenv("FULLKNING_SPECTATE");
+    if (spectate_path != nullptr && !spectators.open(spectate_path))
+        std::cerr << "The spectators' socket could not be opened at " << spectate_path << std::endl;
+    std::thread render_thread([&frames, &rendering, &spectators]() {
+        trace::name("render");
+        allocations::Tag tag(allocations::RENDERING);
+        render::Renderer renderer;
+        latency::Display display; // The keys shown by the frames, until the terminal took them
+        bool waiting = false; // waiting - the front frame isn't printed yet, the terminal is behind
+        while (rendering.load(std::memory_order_relaxed)) {
+            bool fresh = frames.update();
+            if (fresh) {
+                if (waiting) // It's replaced before the terminal could take it
+                    telemetry::dropped.fetch_add(1, std::memory_order_relaxed);
+                waiting = true;
+                spectators.broadcast(frames.getFront());
+            }
+            renderer.flush();
+            bool printing = waiting && renderer.isReady();
+            if (printing) {
+                trace::Span span("render");
+                renderer.render(frames.getFront());
+                display.printed(renderer.getQueued(), frames.getFront().keys);
+                waiting = false;
+            }
+            display.written(renderer.getWritten());
+            game::output_bytes.store(renderer.getWritten(), std::memory_order_relaxed);
+            if (!printing && !fresh)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (frames.update()) { // The last frame
+            spectators.broadcast(frames.getFront());
+            waiting = true;
+        }
+        if (waiting)
+            renderer.render(frames.getFront());
+    }); // The renderer waits for the terminal to take all its output
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    publishFrame(frames, start);
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
     bool finished = false;
-    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    start = std::chrono::steady_clock::now();
+    trace::name("game");
     while (!victory() && !finished) {
-        std::future<int> future = std::async(std::launch::async, []() {
+        allocations::Tag input_tag(allocations::INPUT); // The state of std::async is allocated here
+        std::uint64_t read = 0; // When the key was read (see FULLKNING_LATENCY)
+        std::future<int> future = std::async(std::launch::async, [&read]() {
+            allocations::Tag tag(allocations::INPUT);
+            trace::name("input");
+            trace::Span span("key"); // Waiting for the key, then reading it
             #ifdef _WIN32
-                return getch();
+                int key = getch();
             #elif __APPLE__
-                return getchar();
+                int key = getchar();
             #elif __linux__
-                return (int)getch();
+                int key = (int)getch();
             #endif
+            read = latency::now();
+            return key;
         });
         while (future.wait_for(std::chrono::milliseconds(300)) != std::future_status::ready) {
-            game::frame_countdown--;
-            moveAllSandBlocks();
-            moveStoneBlock(); // There's only one stone block, so we don't need to iterate through a vector
+            allocations::Tag tag(allocations::OTHER); // Each phase of the tick tags its own allocations
+            trace::Span span("tick");
+            std::chrono::steady_clock::time_point tick_start = std::chrono::steady_clock::now();
+            tick(); // The sand blocks and the stone block which are due fall
+            if (telemetry::isRequested()) // SIGUSR1
+                reportTelemetry();
 
-            description_style.apply();
-            cursor.set(6, 15);
-            std::cout << "Time: " << std::chrono::duration_cast<std::chrono::duration<int, std::milli>>(std::chrono::steady_clock::now() - start).count() << "ms      ";
-            cursor.set(8, 15);
-            std::cout << "Score: " << game::score << "      ";
-            cursor.set(10, 15);
-            std::cout << "Targets: " << game::targets.size() << "      ";
-            cursor.set(12, 15);
-            std::cout << "Cooldown: " << std::max(game::frame_countdown, (short)0) << "      ";
-            cursor.set(14, 15);
-            std::cout << "Selected: " << (game::hooked_block == BlockType::Sand ? "Sand" : "Stone") << "      ";
-            #if __linux__ // Ubuntu 22.04 has a low refresh rate...
-                std::cout << std::flush;
-            #endif
+            viewport.update(sista::Coordinates(1, game::state.builder)); // The terminal could have been resized
+            publishFrame(frames, start);
+            if (game::stats.isOpen())
+                game::stats.publish(stats::Sample{
+                    game::state.ticks,
+                    (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - tick_start).count(),
+                    game::state.timers.getUsed(),
+                    game::state.uncovered,
+                    game::output_bytes.load(std::memory_order_relaxed),
+                    allocations::getCount()
+                });
         }
         if (victory())
             break;
 
         char input = future.get();
-        switch (input) {
-            case 'w': case 'W':
-                changeBlockType();
-                break;
-            case 'a': case 'A':
-                field_.movePawnBy(game::builder, 0, -1, PACMAN_EFFECT);
-                break;
-            case 'd': case 'D':
-                field_.movePawnBy(game::builder, 0, 1, PACMAN_EFFECT);
-                break;
-            case 's': case 'S':
-                game::builder->unhook();
-                break;
-            case ' ':
-                stopStoneFalling();
-                break;
-            case 'q': case 'Q':
-                finished = true;
+        {
+            trace::Span span("move");
+            telemetry::Scope scope(telemetry::INPUT);
+            switch (input) {
+                case 'r': case 'R': // Instant restart, the level is copied back
+                    game::history.clear();
+                    game::state = game::beginning;
+                    start = std::chrono::steady_clock::now();
+                    break;
+                case 'u': case 'U': // Back to before the last move, the blocks which fell since then included
+                    game::history.undo(game::state);
+                    break;
+                case 'q': case 'Q':
+                    finished = true;
+                    break;
+                default: // w, a, d, s and space
+                    game::history.mark(game::state); // Each move is a step of the history, with the ticks which follow it
+                    short score = game::state.score;
+                    if (rules::press(game::state, input))
+                        latency::apply(read);
+                    else // Not a key of the game, so not a step
+                        game::history.unmark();
+                    if (game::state.score < score) // Each unhook costs a point
+                        trace::instant("unhook", 2*WIDTH + game::state.builder);
+            }
         }
+        viewport.update(sista::Coordinates(1, game::state.builder)); // The builder could have gone out of the visible part of the field
+        publishFrame(frames, start);
     }
+    if (!finished)
+        trace::instant("victory");
+    rendering = false;
+    render_thread.join();
+    spectators.close();
+    reportTelemetry();
+    reportLatency();
+    dumpTrace();
+    game::stats.close();
     #ifdef __APPLE__
         // noecho.c_lflag &= ~ECHO;, noecho.c_lflag |= ECHO;
         tcsetattr(0, TCSAFLUSH, &orig_termios);
     #endif
     stone_style.apply();
-    cursor.set(HEIGHT + 4, 0);
+    cursor.set(viewport.getRows() + 4, 0);
     if (finished) {
         std::cout << "Game terminated by the user." << std::endl;
+        if (!game::save_path.empty()) {
+            try {
+                rules::save(game::state, game::save_path);
+                std::cout << "The game was saved, it will be resumed next time." << std::endl;
+            } catch (std::runtime_error& e) {
+                std::cout << "The game could not be saved: " << e.what() << std::endl;
+            }
+        }
     } else {
-        std::cout << "You won with " << game::score << " points!" << std::endl;
+        if (!game::save_path.empty())
+            std::remove(game::save_path.c_str()); // The level is over, the next time it starts from the beginning
+        std::cout << "You won with " << game::state.score << " points!" << std::endl;
     }
+    if (game::accounting)
+        allocations::summary(std::cout);
     #if defined(_WIN32) or defined(__linux__)
         getch();
     #elif __APPLE__
@@ -0,0 +1,123 @@
+#include "include/fullkning/stats.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// fullkstat samples the live counters of a running fullkning (see stats.hpp), without touching the game itself
+// fullkstat [pid] [interval-ms] - print the newest sample every interval (1000ms by default)
+// fullkstat [pid] --ring - print all the samples in the ring as CSV, the oldest first
+#ifdef _WIN32
+int main() {
+    std::cerr << "fullkstat needs POSIX shared memory, it's not available on Windows" << std::endl;
+    return 1;
+}
+#else
+std::vector<std::uint64_t> runningGames() { // The pids of the games whose shared memory is in /dev/shm (Linux only)
+    std::vector<std::uint64_t> pids;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/dev/shm", error)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("fullkning.", 0) == 0)
+            pids.push_back(std::strtoull(name.c_str() + 10, nullptr, 10));
+    }
+    return pids;
+}
+
+const stats::Shared* attach(std::uint64_t pid) { // Map the shared memory of the game read-only, nullptr if it can't
+    int descriptor = shm_open(stats::path(pid).c_str(), O_RDONLY, 0);
+    if (descriptor < 0) {
+        std::cerr << "No game with pid " << pid << " is publishing its stats" << std::endl;
+        return nullptr;
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && (std::size_t)status.st_size >= sizeof(stats::Shared))
+        mapping = mmap(nullptr, sizeof(stats::Shared), PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+    const stats::Shared* shared = (const stats::Shared*)mapping;
+    if (mapping == MAP_FAILED || std::memcmp(shared->magic, stats::MAGIC, sizeof(stats::MAGIC)) != 0
+        || shared->size != sizeof(stats::Shared) || shared->slots != STATS_SLOTS) {
+        std::cerr << "The stats of the game with pid " << pid << " have another layout (was it built with another STATS_SLOTS?)" << std::endl;
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return shared;
+}
+
+// Read the slot until the writer isn't in the middle of it
+stats::Sample sample(const stats::Slot& slot) {
+    stats::Sample sample_;
+    while (!stats::read(slot, sample_))
+        std::this_thread::yield();
+    return sample_;
+}
+
+bool isPublishing(std::uint64_t pid) { // The game with the pid has its shared memory
+    int descriptor = shm_open(stats::path(pid).c_str(), O_RDONLY, 0);
+    if (descriptor < 0)
+        return false;
+    close(descriptor);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // The pid can be left out if only one game is running
+    int argument = 1;
+    std::uint64_t pid = argc > argument ? std::strtoull(argv[argument], nullptr, 10) : 0;
+    if (pid != 0 && isPublishing(pid)) {
+        argument++;
+    } else {
+        std::vector<std::uint64_t> pids = runningGames();
+        if (pids.size() != 1) {
+            std::cerr << (pids.empty() ? "No game is publishing its stats (is FULLKNING_STATS set?)" : "More games are running, give the pid of one") << std::endl;
+            std::cerr << "Usage: fullkstat [pid] [interval-ms | --ring]" << std::endl;
+            return 1;
+        }
+        pid = pids[0];
+    }
+    const stats::Shared* shared = attach(pid);
+    if (shared == nullptr)
+        return 1;
+
+    if (argc > argument && std::string(argv[argument]) == "--ring") {
+        std::uint64_t written = shared->written.load(std::memory_order_acquire);
+        std::cout << "tick,duration_ns,falling,uncovered,output_bytes,allocations" << std::endl;
+        for (std::uint64_t i = written > STATS_SLOTS ? written - STATS_SLOTS : 0; i < written; i++) {
+            stats::Sample sample_ = sample(shared->ring[i % STATS_SLOTS]);
+            std::cout << sample_.tick << ',' << sample_.duration << ',' << sample_.falling << ',' << sample_.uncovered << ','
+                << sample_.output << ',' << sample_.allocations << std::endl;
+        }
+        return 0;
+    }
+    int interval = argc > argument ? std::atoi(argv[argument]) : 1000;
+    if (interval <= 0)
+        interval = 1000;
+    std::cout << "    tick   tick µs  falling  targets    output B/s  allocations/s" << std::endl;
+    stats::Sample previous = {};
+    bool first = true;
+    while (true) {
+        std::uint64_t written = shared->written.load(std::memory_order_acquire);
+        if (written > 0) {
+            stats::Sample newest = sample(shared->ring[(written - 1) % STATS_SLOTS]);
+            std::uint64_t output = first ? 0 : (newest.output - previous.output) * 1000 / interval;
+            std::uint64_t allocations = first ? 0 : (newest.allocations - previous.allocations) * 1000 / interval;
+            std::printf("%8llu %9.1f %8llu %8llu %13llu %14llu\n", (unsigned long long)newest.tick, newest.duration / 1000.0,
+                (unsigned long long)newest.falling, (unsigned long long)newest.uncovered, (unsigned long long)output, (unsigned long long)allocations);
+            std::fflush(stdout);
+            previous = newest;
+            first = false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+        if (!isPublishing(pid)) { // The game is over
+            std::cout << "The game with pid " << pid << " ended" << std::endl;
+            return 0;
+        }
+    }
+}
+#endif
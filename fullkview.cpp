@@ -0,0 +1,87 @@
+#include "include/sista/cursor.hpp"
+#include "include/fullkning/spectate.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+// fullkview spectates a running fullkning through its socket (see spectate.hpp), printing the frames with the game's renderer
+// fullkview <socket> - the path of FULLKNING_SPECTATE, it ends when the game does
+#ifdef _WIN32
+int main() {
+    std::cerr << "fullkview needs Unix domain sockets, it's not available on Windows" << std::endl;
+    return 1;
+}
+#else
+bool receive(int socket_, void* buffer, std::size_t size) { // Read exactly size bytes, false if the game closed the socket
+    char* bytes = (char*)buffer;
+    while (size > 0) {
+        ssize_t received = recv(socket_, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= (std::size_t)received;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: fullkview <socket>, the path the game was given in FULLKNING_SPECTATE" << std::endl;
+        return 1;
+    }
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(argv[1]) >= sizeof(address.sun_path)) {
+        std::cerr << "The path of the socket is too long" << std::endl;
+        return 1;
+    }
+    std::strcpy(address.sun_path, argv[1]);
+    int socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_ < 0 || connect(socket_, (sockaddr*)&address, sizeof(address)) < 0) {
+        std::cerr << "No game is streaming on " << argv[1] << " (is FULLKNING_SPECTATE set?)" << std::endl;
+        return 1;
+    }
+
+    std::string ending = "The game ended.";
+    {
+        sista::Cursor cursor;
+        render::Frame frame;
+        {
+            render::Renderer renderer;
+            bool synced = false; // synced - a keyframe was received, so the diffs apply
+            bool rendered = true; // rendered - the last frame received was printed
+            std::vector<char> payload;
+            spectate::Header header;
+            while (receive(socket_, &header, sizeof(header))) {
+                if (std::memcmp(header.magic, spectate::MAGIC, sizeof(spectate::MAGIC)) != 0 || header.size > spectate::MAX_PAYLOAD) {
+                    ending = "The game sent something which isn't a frame.";
+                    break;
+                }
+                payload.resize(header.size);
+                if (!receive(socket_, payload.data(), payload.size()))
+                    break;
+                if (!spectate::decode(header.type, payload, frame, synced)) {
+                    ending = "The game sent a malformed frame.";
+                    break;
+                }
+                renderer.flush();
+                rendered = renderer.isReady(); // Otherwise the frame is skipped, the terminal is behind
+                if (rendered)
+                    renderer.render(frame);
+            }
+            if (!rendered)
+                renderer.render(frame);
+        } // The renderer waits for the terminal to take all its output
+        ANSI::reset();
+        cursor.set(frame.rows + 4, 0); // Below the field, as the game does
+    }
+    close(socket_);
+    std::cout << std::endl << ending << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <cstddef> // std::max_align_t
+#include <cstdlib> // std::malloc, std::free
+#include <new> // std::bad_alloc
+#include <atomic> // std::atomic
+#include <string> // std::string, std::to_string
+#include <ostream> // std::ostream
+
+
+// Accounts the heap allocations of the whole program by subsystem, by replacing the global operator new and delete
+// Each allocation is tagged with the subsystem of the thread which made it (see Tag), and carries a small header
+// so that its size and subsystem are known when it's freed
+// Compile with FULLKNING_NO_ALLOCATIONS to keep the allocator of the standard library: the tags do nothing and the counts stay 0
+// ⚠️ Include it in a single translation unit, the one with main()
+namespace allocations {
+    enum Subsystem : unsigned char {
+        OTHER = 0, // OTHER - whatever isn't tagged
+        PHYSICS = 1, // PHYSICS - the ticks of the rules
+        LEVEL = 2, // LEVEL - loading and resuming the levels
+        RENDERING = 3, // RENDERING - the frames and the terminal output
+        INPUT = 4, // INPUT - reading the keys and applying them (the history of the moves too)
+        EDITOR = 5, // EDITOR - levelmaker
+        SUBSYSTEMS = 6
+    };
+    const char* const NAMES[SUBSYSTEMS] = {"other", "physics", "level", "rendering", "input", "editor"};
+
+    struct Account { // Account - the allocations of a subsystem since the program started
+        std::atomic<std::uint64_t> allocations{0};
+        std::atomic<std::uint64_t> frees{0};
+        std::atomic<std::uint64_t> bytes{0}; // bytes - allocated, the frees aren't subtracted
+        std::atomic<std::uint64_t> live{0}; // live - bytes allocated and not freed yet
+        std::atomic<std::uint64_t> peak{0}; // peak - highest live
+    };
+    Account accounts[SUBSYSTEMS];
+    Account total; // total - all the subsystems together, its peak is of the sum
+
+    // Tag - the allocations of the thread belong to the subsystem until the end of the scope
+    #ifndef FULLKNING_NO_ALLOCATIONS
+        thread_local Subsystem current = OTHER; // current - the subsystem of what the thread is doing now
+
+        class Tag {
+        private:
+            Subsystem previous;
+
+        public:
+            Tag(Subsystem subsystem): previous(current) {
+                current = subsystem;
+            }
+            ~Tag() {
+                current = previous;
+            }
+            Tag(const Tag&) = delete;
+            Tag& operator=(const Tag&) = delete;
+        };
+    #else
+        class Tag {
+        public:
+            Tag(Subsystem) {}
+            Tag(const Tag&) = delete;
+            Tag& operator=(const Tag&) = delete;
+        };
+    #endif
+
+    // Header - in front of each allocation, padded so that the memory after it stays aligned as malloc's
+    struct alignas(std::max_align_t) Header {
+        std::size_t size;
+        Subsystem subsystem;
+    };
+
+    void raise(std::atomic<std::uint64_t>& peak, std::uint64_t value) { // raise - peak is at least value
+        std::uint64_t current_ = peak.load(std::memory_order_relaxed);
+        while (value > current_ && !peak.compare_exchange_weak(current_, value, std::memory_order_relaxed));
+    }
+    void allocated(Subsystem subsystem, std::size_t size) {
+        for (Account* account : {&accounts[subsystem], &total}) {
+            account->allocations.fetch_add(1, std::memory_order_relaxed);
+            account->bytes.fetch_add(size, std::memory_order_relaxed);
+            raise(account->peak, account->live.fetch_add(size, std::memory_order_relaxed) + size);
+        }
+    }
+    void freed(Subsystem subsystem, std::size_t size) {
+        for (Account* account : {&accounts[subsystem], &total}) {
+            account->frees.fetch_add(1, std::memory_order_relaxed);
+            account->live.fetch_sub(size, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t getCount() { // getCount - allocations since the program started
+        return total.allocations.load(std::memory_order_relaxed);
+    }
+    std::uint64_t getLive() { // getLive - bytes allocated and not freed yet
+        return total.live.load(std::memory_order_relaxed);
+    }
+    std::uint64_t getPeak() {
+        return total.peak.load(std::memory_order_relaxed);
+    }
+
+    // summary - what each subsystem allocated and what is still allocated, e.g. at exit to spot the leaks
+    void summary(std::ostream& output) {
+        #ifdef FULLKNING_NO_ALLOCATIONS
+            output << "Allocations not accounted (compiled with FULLKNING_NO_ALLOCATIONS)" << std::endl;
+        #else
+            output << "Allocations by subsystem (allocations, frees, bytes, peak bytes, still allocated):" << std::endl;
+            for (unsigned subsystem = 0; subsystem < SUBSYSTEMS; subsystem++) {
+                const Account& account = accounts[subsystem];
+                std::uint64_t allocations_ = account.allocations.load(std::memory_order_relaxed);
+                if (allocations_ == 0)
+                    continue;
+                std::uint64_t frees = account.frees.load(std::memory_order_relaxed);
+                output << "  " << NAMES[subsystem] << ": " << allocations_ << ", " << frees << ", " << account.bytes.load(std::memory_order_relaxed) << ", "
+                    << account.peak.load(std::memory_order_relaxed) << ", " << allocations_ - frees << " (" << account.live.load(std::memory_order_relaxed) << " bytes)" << std::endl;
+            }
+        #endif
+    }
+};
+
+#ifndef FULLKNING_NO_ALLOCATIONS
+void* operator new(std::size_t size) {
+    allocations::Header* header = (allocations::Header*)std::malloc(sizeof(allocations::Header) + size);
+    if (header == nullptr)
+        throw std::bad_alloc();
+    header->size = size;
+    header->subsystem = allocations::current;
+    allocations::allocated(header->subsystem, size);
+    return header + 1;
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+// The pointers freed here all come from the operator new above, which GCC can't tell once a delete is inlined
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr)
+        return;
+    allocations::Header* header = (allocations::Header*)pointer - 1;
+    allocations::freed(header->subsystem, header->size);
+    std::free(header);
+}
+void operator delete[](void* pointer) noexcept {
+    operator delete(pointer);
+}
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+    #pragma GCC diagnostic pop
+#endif
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <vector> // std::vector
+
+
+namespace level {
+    // Bitmap - one bit per cell, rows padded to whole 64-bit words so that empty spans are skipped a word at a time
+    class Bitmap {
+    private:
+        unsigned short width; // width - number of columns
+        unsigned short height; // height - number of rows
+        std::size_t stride; // stride - number of words of each row
+        std::vector<std::uint64_t> words; // words[y*stride + x/64] - bit x%64 is the cell [y][x]
+
+        static unsigned ones(std::uint64_t word) { // ones - number of set bits of the word
+            #if defined(__GNUC__) || defined(__clang__)
+                return (unsigned)__builtin_popcountll(word);
+            #else
+                unsigned total = 0;
+                for (; word; word &= word - 1)
+                    total++;
+                return total;
+            #endif
+        }
+        static unsigned lowest(std::uint64_t word) { // lowest - index of the lowest set bit of a word which isn't 0
+            #if defined(__GNUC__) || defined(__clang__)
+                return (unsigned)__builtin_ctzll(word);
+            #else
+                unsigned index = 0;
+                for (; !(word & 1); word >>= 1)
+                    index++;
+                return index;
+            #endif
+        }
+
+    public:
+        Bitmap(unsigned short width_, unsigned short height_): width(width_), height(height_) {
+            stride = ((std::size_t)width + 63) / 64;
+            words.resize(stride * height, 0);
+        }
+
+        unsigned short getWidth() const {
+            return width;
+        }
+        unsigned short getHeight() const {
+            return height;
+        }
+        bool isOutOfBounds(int y, int x) const {
+            return (y < 0 || y >= height || x < 0 || x >= width);
+        }
+
+        bool get(unsigned short y, unsigned short x) const {
+            return (words[y*stride + x/64] >> (x%64)) & 1;
+        }
+        void set(unsigned short y, unsigned short x, bool value=true) {
+            std::uint64_t mask = (std::uint64_t)1 << (x%64);
+            if (value)
+                words[y*stride + x/64] |= mask;
+            else
+                words[y*stride + x/64] &= ~mask;
+        }
+        void toggle(unsigned short y, unsigned short x) {
+            words[y*stride + x/64] ^= (std::uint64_t)1 << (x%64);
+        }
+        void clear() {
+            for (std::uint64_t& word : words)
+                word = 0;
+        }
+
+        std::size_t count() const { // count - number of set cells
+            std::size_t total = 0;
+            for (std::uint64_t word : words)
+                total += ones(word);
+            return total;
+        }
+        template <typename Function>
+        void forEach(Function function) const { // forEach - call function(y, x) for each set cell, in row-major order
+            for (std::size_t i = 0; i < words.size(); i++) {
+                std::uint64_t word = words[i];
+                while (word) { // Only the set bits are visited
+                    unsigned short x = (unsigned short)((i % stride)*64 + lowest(word));
+                    function((unsigned short)(i / stride), x);
+                    word &= word - 1; // Clear the lowest set bit
+                }
+            }
+        }
+    };
+};
@@ -0,0 +1,77 @@
+// Generated by levelpack from levels/*.level, do not edit
+#pragma once
+
+#include "level.hpp" // Embedded
+
+
+namespace level {
+    constexpr unsigned short level_1[][2] = {
+        {17, 4}, {17, 5}, {18, 3}, {18, 4}, {18, 5}, {18, 6}, {19, 2}, {19, 3},
+        {19, 4}, {19, 5}, {19, 6}, {19, 7},
+    }; // levels/1.level
+    constexpr unsigned short level_2[][2] = {
+        {17, 5}, {19, 5},
+    }; // levels/2.level
+    constexpr unsigned short level_3[][2] = {
+        {15, 3}, {15, 6}, {16, 3}, {16, 6}, {17, 4}, {17, 5}, {18, 4}, {18, 5},
+        {19, 4}, {19, 5},
+    }; // levels/3.level
+    constexpr unsigned short level_4[][2] = {
+        {13, 1}, {13, 8}, {15, 2}, {15, 3}, {15, 6}, {15, 7}, {16, 2}, {16, 3},
+        {16, 6}, {16, 7}, {17, 4}, {17, 5}, {18, 3}, {18, 6}, {19, 2}, {19, 7},
+    }; // levels/4.level
+    constexpr unsigned short level_5[][2] = {
+        {9, 7}, {9, 2}, {9, 4}, {9, 5}, {13, 4}, {13, 5}, {16, 4}, {16, 5},
+        {17, 4}, {17, 5},
+    }; // levels/5.level
+    constexpr unsigned short level_6[][2] = {
+        {4, 2}, {4, 3}, {4, 4}, {4, 5}, {4, 6}, {4, 7}, {8, 3}, {8, 4},
+        {8, 5}, {8, 6}, {11, 4}, {11, 5}, {13, 2}, {13, 3}, {13, 4}, {13, 5},
+        {13, 6}, {13, 7},
+    }; // levels/6.level
+    constexpr unsigned short level_7[][2] = {
+        {9, 4}, {9, 5}, {10, 3}, {10, 6}, {11, 2}, {11, 7}, {12, 1}, {12, 8},
+        {14, 1}, {14, 2}, {14, 3}, {14, 6}, {14, 7}, {14, 8}, {15, 3}, {15, 6},
+        {16, 4}, {16, 5}, {17, 3}, {17, 6}, {18, 3}, {18, 6}, {19, 1}, {19, 2},
+        {19, 3}, {19, 4}, {19, 5}, {19, 6}, {19, 7}, {19, 8},
+    }; // levels/7.level
+    constexpr unsigned short level_8[][2] = {
+        {13, 2}, {13, 3}, {13, 6}, {13, 7}, {14, 1}, {14, 4}, {14, 5}, {14, 8},
+        {15, 1}, {15, 8}, {16, 2}, {16, 7}, {17, 3}, {17, 6}, {18, 4}, {18, 5},
+    }; // levels/8.level
+    constexpr unsigned short level_9[][2] = {
+        {2, 1}, {2, 3}, {2, 4}, {2, 5}, {2, 6}, {2, 8}, {3, 2}, {3, 7},
+        {5, 2}, {5, 3}, {5, 6}, {5, 7}, {6, 1}, {6, 4}, {6, 5}, {6, 8},
+        {8, 1}, {8, 3}, {8, 6}, {8, 8}, {9, 1}, {9, 2}, {9, 3}, {9, 4},
+        {9, 5}, {9, 6}, {9, 7}, {9, 8},
+    }; // levels/9.level
+    constexpr unsigned short level_10[][2] = {
+        {10, 4}, {14, 4}, {15, 0}, {15, 2}, {15, 6}, {15, 8}, {16, 2}, {16, 6},
+        {17, 4}, {18, 4}, {19, 1}, {19, 2}, {19, 3}, {19, 4}, {19, 5}, {19, 6},
+        {19, 7},
+    }; // levels/10.level
+    constexpr unsigned short level_11[][2] = {
+        {8, 3}, {8, 4}, {8, 5}, {9, 3}, {9, 5}, {10, 2}, {10, 3}, {10, 4},
+        {10, 5}, {10, 6}, {11, 4},
+    }; // levels/11.level
+    constexpr unsigned short level_12[][2] = {
+        {8, 3}, {9, 3}, {9, 4}, {10, 1}, {10, 3}, {10, 4}, {10, 5}, {10, 6},
+        {10, 7}, {11, 7}, {12, 1}, {12, 3}, {12, 4}, {12, 5}, {12, 6}, {12, 7},
+        {13, 3}, {13, 4}, {14, 3},
+    }; // levels/12.level
+
+    constexpr Embedded catalogue[] = {
+        {"1", level_1, 12},
+        {"2", level_2, 2},
+        {"3", level_3, 10},
+        {"4", level_4, 16},
+        {"5", level_5, 10},
+        {"6", level_6, 18},
+        {"7", level_7, 30},
+        {"8", level_8, 16},
+        {"9", level_9, 28},
+        {"10", level_10, 17},
+        {"11", level_11, 11},
+        {"12", level_12, 19},
+    };
+};
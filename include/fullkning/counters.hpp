@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memset, std::strerror
+#include <string> // std::string
+#ifdef __linux__
+    #include <cerrno> // errno
+    #include <linux/perf_event.h> // perf_event_attr, PERF_*
+    #include <sys/ioctl.h> // ioctl
+    #include <sys/syscall.h> // SYS_perf_event_open
+    #include <unistd.h> // syscall, read, close
+#endif
+
+
+// Hardware performance counters of the calling thread, read around a measured region (Linux perf_event_open)
+// Each counter is opened on its own, so one the CPU or the kernel doesn't offer is just missing
+// Elsewhere, or when perf_event_paranoid or a container forbids them, no counter is available and the regions are only timed
+namespace counters {
+    enum Counter : unsigned char {
+        CYCLES = 0,
+        INSTRUCTIONS = 1,
+        L1_MISSES = 2, // L1_MISSES - L1 data cache read misses
+        LLC_MISSES = 3, // LLC_MISSES - last level cache misses
+        BRANCH_MISSES = 4,
+        COUNTERS = 5
+    };
+    const char* const NAMES[COUNTERS] = {"cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+    struct Reading { // Reading - the counts of a region, valid[counter] is false for the counters which aren't available
+        std::uint64_t counts[COUNTERS] = {};
+        bool valid[COUNTERS] = {};
+    };
+
+    // Group - the counters of the calling thread, user space only, started and stopped together
+    class Group {
+    private:
+        #ifdef __linux__
+            int leader = -1; // leader - the first counter opened, the others start and stop with it
+            int descriptors[COUNTERS] = {-1, -1, -1, -1, -1};
+            unsigned char order[COUNTERS]; // order[i] - the counter of the i-th value read from the group
+            unsigned char opened = 0;
+        #endif
+        std::string error; // error - why some counters aren't available, empty if they all are
+
+        #ifdef __linux__
+            int open(std::uint32_t type, std::uint64_t config) {
+                perf_event_attr attribute;
+                std::memset(&attribute, 0, sizeof(perf_event_attr));
+                attribute.size = sizeof(perf_event_attr);
+                attribute.type = type;
+                attribute.config = config;
+                attribute.disabled = leader < 0; // Only the leader is enabled and disabled
+                attribute.exclude_kernel = 1; // Allowed with perf_event_paranoid up to 2
+                attribute.exclude_hv = 1;
+                attribute.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                return (int)syscall(SYS_perf_event_open, &attribute, 0, -1, leader, 0); // This thread, any CPU
+            }
+        #endif
+
+    public:
+        Group() {
+            #ifdef __linux__
+                const std::uint32_t types[COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+                const std::uint64_t configs[COUNTERS] = {
+                    PERF_COUNT_HW_CPU_CYCLES,
+                    PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                    PERF_COUNT_HW_CACHE_MISSES,
+                    PERF_COUNT_HW_BRANCH_MISSES
+                };
+                for (unsigned char counter = 0; counter < COUNTERS; counter++) {
+                    int descriptor = open(types[counter], configs[counter]);
+                    if (descriptor < 0) {
+                        error += (error.empty() ? "" : ", ") + std::string(NAMES[counter]) + ": " + std::strerror(errno);
+                        continue;
+                    }
+                    if (leader < 0)
+                        leader = descriptor;
+                    descriptors[counter] = descriptor;
+                    order[opened++] = counter;
+                }
+            #else
+                error = "perf_event_open is only available on Linux";
+            #endif
+        }
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+        ~Group() {
+            #ifdef __linux__
+                for (int descriptor : descriptors)
+                    if (descriptor >= 0)
+                        close(descriptor);
+            #endif
+        }
+
+        void start() { // start - reset the counters and start counting
+            #ifdef __linux__
+                if (leader < 0)
+                    return;
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            #endif
+        }
+        // stop - stop counting, returns the counts since start()
+        // If the kernel multiplexed the counters with others, the counts are scaled to the whole region
+        Reading stop() {
+            Reading reading;
+            #ifdef __linux__
+                if (leader < 0)
+                    return reading;
+                ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+                std::uint64_t values[3 + COUNTERS]; // Number of values, time enabled, time running, then the values
+                if (read(leader, values, sizeof(values)) < (ssize_t)(3 * sizeof(std::uint64_t)) || values[0] != opened || values[2] == 0)
+                    return reading;
+                for (unsigned char i = 0; i < opened; i++) {
+                    reading.counts[order[i]] = (std::uint64_t)((double)values[3 + i] * values[1] / values[2]);
+                    reading.valid[order[i]] = true;
+                }
+            #endif
+            return reading;
+        }
+
+        bool isAvailable() const { // isAvailable - at least one counter can be read
+            #ifdef __linux__
+                return leader >= 0;
+            #else
+                return false;
+            #endif
+        }
+        const std::string& getError() const {
+            return error;
+        }
+    };
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memcpy
+#include <stdexcept> // std::invalid_argument
+#include <memory> // std::unique_ptr
+#include <vector> // std::vector
+#include <thread> // std::thread
+#include <mutex> // std::mutex, std::unique_lock
+#include <condition_variable> // std::condition_variable
+#include <algorithm> // std::min
+#include "state.hpp" // rules::State, rules::Timers, rules::tick, rules::press, WIDTH, HEIGHT
+#include "level.hpp" // level::Embedded, level::fromEmbedded
+
+#define OBSERVATION (WIDTH*HEIGHT + 3) // Bytes of the observation of a game: the cells, then the selected block, the cooldown and if a stone is falling
+#ifndef PARALLEL_ENVS
+    #define PARALLEL_ENVS 4096 // Number of games from which env::Batch::step() uses all the cores
+#endif
+
+
+namespace env {
+    enum Action : unsigned char { // Action - what an agent does in a step, the keys of the game
+        WAIT = 0, // WAIT - no key, the time just goes on
+        CHANGE = 1, // CHANGE - 'w', switch between Sand and Stone
+        LEFT = 2, // LEFT - 'a'
+        RIGHT = 3, // RIGHT - 'd'
+        UNHOOK = 4, // UNHOOK - 's'
+        STOP = 5 // STOP - ' ', stop the falling stone
+    };
+    const char KEYS[] = {0, 'w', 'a', 'd', 's', ' '}; // KEYS[action] - the key of the action
+    const unsigned char BUILDER = 8; // BUILDER - the builder's cell in the observations, the others are rules::Cell
+
+    enum Done : unsigned char { // Done - why a game ended in a step, it's then started again
+        RUNNING = 0,
+        WON = 1,
+        TRUNCATED = 2 // TRUNCATED - the game reached the limit of ticks
+    };
+
+    // levels - the start states of the levels of a catalogue (see catalogue.hpp), to reset the games
+    template <std::size_t N>
+    std::vector<rules::State> levels(const level::Embedded (&catalogue)[N]) {
+        std::vector<rules::State> states(N);
+        for (std::size_t i = 0; i < N; i++)
+            rules::start(states[i], level::fromEmbedded(catalogue[i]));
+        return states;
+    }
+
+    // Batch - many independent games advanced in lockstep, stored as structure of arrays
+    // Each step applies one action to each game and then a tick, the same rules as the game (see rules::tick)
+    // A game which is won or truncated is started again on a random level, its observation is the new start
+    // A big batch keeps a thread per share of the games for its whole life, woken at each step
+    class Batch {
+    private:
+        std::size_t size; // size - number of games
+        std::vector<rules::State> levels; // levels - start states to reset the games to
+        unsigned int limit; // limit - ticks after which a game is truncated (0 - never)
+        unsigned threads; // threads - threads used by step() for a big batch
+
+        // The members of rules::State, one array each
+        std::unique_ptr<unsigned char[][HEIGHT][WIDTH]> cells;
+        std::unique_ptr<rules::Timers[]> timers;
+        std::unique_ptr<short[]> stone;
+        std::unique_ptr<unsigned short[]> stoneTimer;
+        std::unique_ptr<unsigned char[]> builder;
+        std::unique_ptr<bool[]> stoneSelected;
+        std::unique_ptr<short[]> score;
+        std::unique_ptr<unsigned int[]> ready;
+        std::unique_ptr<unsigned short[]> targets;
+        std::unique_ptr<unsigned short[]> uncovered;
+        std::unique_ptr<unsigned int[]> ticks;
+        std::unique_ptr<std::uint64_t[]> random; // random - xorshift state of each game, to choose the next level
+
+        // The workers of step(), the calling thread does the first share of the games and workers[k] the (k+1)-th
+        struct Arguments { // Arguments - those of the step being done [mutex]
+            const unsigned char* actions;
+            unsigned char* observations;
+            short* rewards;
+            unsigned char* dones;
+        };
+        std::vector<std::thread> workers;
+        std::size_t share = 0; // share - games of each thread
+        std::mutex mutex;
+        std::condition_variable wake; // wake - a step was started, or the batch is destroyed
+        std::condition_variable finished; // finished - the workers did their shares of the step
+        Arguments arguments = {};
+        unsigned long long steps = 0; // steps - steps started [mutex]
+        unsigned pending = 0; // pending - workers which didn't finish their share of the step yet [mutex]
+        bool stopping = false; // [mutex]
+
+        struct Game { // Game - the i-th game as the rules see it, the members are references to the arrays
+            unsigned char (*cells)[WIDTH];
+            rules::Timers& timers;
+            short& stone;
+            unsigned short& stoneTimer;
+            unsigned char& builder;
+            bool& stoneSelected;
+            short& score;
+            unsigned int& ready;
+            unsigned short& uncovered;
+            unsigned int& ticks;
+        };
+        Game game(std::size_t i) {
+            return Game{cells[i], timers[i], stone[i], stoneTimer[i], builder[i], stoneSelected[i], score[i], ready[i], uncovered[i], ticks[i]};
+        }
+        void work(std::size_t first, std::size_t last) { // work - a worker, which steps the games from first to last (excluded)
+            unsigned long long done = 0; // done - steps done
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [&]() {
+                    return stopping || steps != done;
+                });
+                if (stopping)
+                    return;
+                done = steps;
+                Arguments step_ = arguments;
+                lock.unlock();
+                step(step_.actions, step_.observations, step_.rewards, step_.dones, first, last);
+                lock.lock();
+                if (--pending == 0)
+                    finished.notify_one();
+            }
+        }
+
+        void reset(std::size_t i) { // reset - start the i-th game on a random level
+            std::uint64_t& x = random[i];
+            x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+            const rules::State& level = levels[x % levels.size()];
+            std::memcpy(cells[i], level.cells, sizeof(level.cells));
+            timers[i] = level.timers;
+            stone[i] = level.stone;
+            stoneTimer[i] = level.stoneTimer;
+            builder[i] = level.builder;
+            stoneSelected[i] = level.stoneSelected;
+            score[i] = level.score;
+            ready[i] = level.ready;
+            targets[i] = level.targets;
+            uncovered[i] = level.uncovered;
+            ticks[i] = level.ticks;
+        }
+        void observe(std::size_t i, unsigned char* observation) { // observe - write the observation of the i-th game
+            std::memcpy(observation, cells[i], WIDTH*HEIGHT);
+            observation[WIDTH + builder[i]] = BUILDER; // Row 1
+            observation[WIDTH*HEIGHT] = stoneSelected[i];
+            observation[WIDTH*HEIGHT + 1] = (unsigned char)(ready[i] > ticks[i] ? ready[i] - ticks[i] : 0);
+            observation[WIDTH*HEIGHT + 2] = stone[i] >= 0;
+        }
+
+    public:
+        // Batch - size_ games on the levels_, started with seed, truncated after limit_ ticks
+        // ⚠️ This throws a std::invalid_argument if there are no levels_
+        Batch(std::size_t size_, const std::vector<rules::State>& levels_, std::uint64_t seed=1, unsigned int limit_=1000, unsigned threads_=std::thread::hardware_concurrency()):
+            size(size_), levels(levels_), limit(limit_), threads(std::max(1u, threads_)) {
+            if (levels.empty()) // A game couldn't be reset
+                throw std::invalid_argument("A Batch needs at least one level");
+            cells.reset(new unsigned char[size][HEIGHT][WIDTH]);
+            timers.reset(new rules::Timers[size]);
+            stone.reset(new short[size]);
+            stoneTimer.reset(new unsigned short[size]);
+            builder.reset(new unsigned char[size]);
+            stoneSelected.reset(new bool[size]);
+            score.reset(new short[size]);
+            ready.reset(new unsigned int[size]);
+            targets.reset(new unsigned short[size]);
+            uncovered.reset(new unsigned short[size]);
+            ticks.reset(new unsigned int[size]);
+            random.reset(new std::uint64_t[size]);
+            for (std::size_t i = 0; i < size; i++) {
+                random[i] = (seed + i) * 0x9E3779B97F4A7C15ull | 1; // Never 0, which xorshift can't leave
+                reset(i);
+            }
+            if (size < PARALLEL_ENVS || threads == 1)
+                return;
+            share = (size + threads - 1) / threads;
+            for (std::size_t first = share; first < size; first += share)
+                workers.emplace_back(&Batch::work, this, first, std::min(size, first + share));
+        }
+        ~Batch() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers)
+                worker.join();
+        }
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        // step - apply actions[i] to the i-th game and tick, for each game from first to last (excluded)
+        // observations[i*OBSERVATION...] - the observation after the step, rewards[i] - the change of the score, dones[i] - a Done
+        // A won game is also rewarded with three points per target, so a won game is worth its final score
+        void step(const unsigned char* actions, unsigned char* observations, short* rewards, unsigned char* dones, std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; i++) {
+                Game game_ = game(i);
+                short before = score[i];
+                if (actions[i] != WAIT && actions[i] <= STOP)
+                    rules::press(game_, KEYS[actions[i]]);
+                rules::tick(game_);
+                rewards[i] = score[i] - before;
+                dones[i] = RUNNING;
+                if (rules::victory(game_)) {
+                    rewards[i] += 3*targets[i];
+                    dones[i] = WON;
+                } else if (limit != 0 && ticks[i] >= limit) {
+                    dones[i] = TRUNCATED;
+                }
+                if (dones[i] != RUNNING)
+                    reset(i);
+                observe(i, observations + i*OBSERVATION);
+            }
+        }
+        // step - all the games, split among the threads if there are at least PARALLEL_ENVS of them
+        void step(const unsigned char* actions, unsigned char* observations, short* rewards, unsigned char* dones) {
+            if (workers.empty()) {
+                step(actions, observations, rewards, dones, 0, size);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                arguments = Arguments{actions, observations, rewards, dones};
+                pending = (unsigned)workers.size();
+                steps++;
+            }
+            wake.notify_all();
+            step(actions, observations, rewards, dones, 0, share);
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this]() {
+                return pending == 0;
+            });
+        }
+        void observe(unsigned char* observations) { // observe - write the observations of all the games, e.g. before the first step
+            for (std::size_t i = 0; i < size; i++)
+                observe(i, observations + i*OBSERVATION);
+        }
+
+        std::size_t getSize() {
+            return size;
+        }
+        short getScore(std::size_t i) {
+            return score[i];
+        }
+    };
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <string> // std::string, std::to_string
+#include <vector> // std::vector
+#include <cstdint> // std::uint64_t
+#include <chrono> // std::chrono::steady_clock, std::chrono::milliseconds
+#include <algorithm> // std::min
+#include "../sista/ANSI-Settings.hpp" // ANSI::ForegroundColor, ANSI::BackgroundColor, ANSI::Attribute, CSI
+#include "../sista/cursor.hpp" // CHA
+#include "telemetry.hpp" // telemetry::Scope
+#ifndef _WIN32
+    #include <cerrno> // errno, EINTR, EAGAIN
+    #include <fcntl.h> // open, fcntl, O_NONBLOCK
+    #include <poll.h> // poll
+    #include <unistd.h> // write, close, isatty, ttyname
+#endif
+
+#ifndef OUTPUT_QUEUE
+    #define OUTPUT_QUEUE 16384 // Bytes which can wait for the terminal, beyond them the new frames are dropped
+#endif
+#ifndef DRAIN_TIMEOUT
+    #define DRAIN_TIMEOUT 2000 // Milliseconds Terminal::drain() waits for the terminal, then the rest of the output is dropped
+#endif
+
+
+namespace render {
+    struct Cell { // Cell - what is printed on a cell of the field
+        char symbol = ' '; // symbol - ' ' for an empty cell
+        unsigned char foreground = ANSI::ForegroundColor::F_WHITE;
+        unsigned char background = ANSI::BackgroundColor::B_BLACK;
+        unsigned char attribute = ANSI::Attribute::RESET;
+
+        bool operator==(const Cell& other) const {
+            return (symbol == other.symbol && foreground == other.foreground && background == other.background && attribute == other.attribute);
+        }
+        bool operator!=(const Cell& other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct Frame { // Frame - immutable snapshot of what the screen shows after a tick
+        unsigned short top = 0, left = 0; // top, left - first visible row and column of the field
+        unsigned short rows = 0, columns = 0; // rows, columns - size of the visible part of the field
+        std::vector<Cell> cells; // cells[y*columns + x] - the visible part of the field
+        // HUD values
+        int time = 0; // time - milliseconds since the game started
+        short score = 0;
+        std::size_t targets = 0;
+        short cooldown = 0;
+        bool stone = false; // stone - the selected block is Stone (otherwise Sand)
+        bool heap = false; // heap - the heap is accounted, heapLive and heapPeak are shown
+        std::uint64_t heapLive = 0, heapPeak = 0; // heapLive, heapPeak - bytes allocated now and at most
+        std::uint64_t keys = 0; // keys - keys applied before the frame was captured (see latency.hpp)
+
+        bool sameWindow(const Frame& other) const {
+            return (top == other.top && left == other.left && rows == other.rows && columns == other.columns);
+        }
+    };
+
+    // Terminal - the standard output, written without ever blocking: what the terminal can't take yet waits in a queue
+    // On a terminal the device is opened again, since stdin shares the file description of stdout and getch() must keep blocking
+    // ⚠️ Nothing else may write to the standard output while it exists
+    class Terminal {
+    private:
+        std::string queue; // queue - output not written yet, from sent on
+        std::size_t sent = 0;
+        std::uint64_t written = 0; // written - bytes written since the terminal was opened
+        #ifndef _WIN32
+            int descriptor = STDOUT_FILENO;
+            int flags = -1; // flags - of the standard output before, restored at the end when it isn't a terminal
+        #endif
+
+    public:
+        Terminal() {
+            std::cout << std::flush; // What was printed before goes first
+            #ifndef _WIN32
+                if (isatty(STDOUT_FILENO)) { // If it can't be opened again, the writes block rather than getch() stop blocking
+                    const char* name = ttyname(STDOUT_FILENO);
+                    int reopened = name != nullptr ? open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK) : -1;
+                    if (reopened >= 0)
+                        descriptor = reopened;
+                } else { // A pipe or a file
+                    flags = fcntl(STDOUT_FILENO, F_GETFL);
+                    if (flags >= 0)
+                        fcntl(STDOUT_FILENO, F_SETFL, flags | O_NONBLOCK);
+                }
+            #endif
+        }
+        Terminal(const Terminal&) = delete;
+        Terminal& operator=(const Terminal&) = delete;
+        ~Terminal() {
+            drain();
+            #ifndef _WIN32
+                if (descriptor != STDOUT_FILENO)
+                    close(descriptor);
+                else if (flags >= 0)
+                    fcntl(STDOUT_FILENO, F_SETFL, flags);
+            #endif
+        }
+
+        void write(const std::string& output) { // write - queue the output, then write what the terminal takes
+            queue += output;
+            flush();
+        }
+        // flush - write what the terminal takes now, without waiting
+        // If the terminal is gone, what is queued is thrown away
+        void flush() {
+            std::size_t before = sent;
+            #ifdef _WIN32
+                std::cout.write(queue.data() + sent, queue.size() - sent) << std::flush;
+                sent = queue.size();
+            #else
+                while (sent < queue.size()) {
+                    ssize_t written = ::write(descriptor, queue.data() + sent, queue.size() - sent);
+                    if (written > 0)
+                        sent += (std::size_t)written;
+                    else if (written < 0 && errno == EINTR)
+                        continue;
+                    else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                        break;
+                    else
+                        sent = queue.size();
+                }
+            #endif
+            written += sent - before;
+            if (sent == queue.size()) {
+                queue.clear(); // The capacity is kept
+                sent = 0;
+            } else if (sent > queue.size() / 2) {
+                queue.erase(0, sent);
+                sent = 0;
+            }
+        }
+        // drain - wait until the terminal took everything, for at most DRAIN_TIMEOUT milliseconds (a stopped terminal never would)
+        void drain() {
+            flush();
+            #ifndef _WIN32
+                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(DRAIN_TIMEOUT);
+                while (getPending() > 0) {
+                    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                    if (now >= deadline)
+                        break;
+                    int timeout = (int)std::min<long long>(100, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1);
+                    pollfd terminal = {descriptor, POLLOUT, 0};
+                    if (poll(&terminal, 1, timeout) < 0 && errno != EINTR)
+                        break;
+                    flush();
+                }
+                queue.clear(); // What the terminal didn't take in time is dropped
+                sent = 0;
+            #endif
+        }
+        std::size_t getPending() const { // getPending - bytes the terminal didn't take yet
+            return queue.size() - sent;
+        }
+        std::uint64_t getWritten() const {
+            return written;
+        }
+    };
+
+    // Renderer - turns frames into terminal output, only the cells which changed since the last frame are printed
+    // A slow terminal never blocks it: while more than OUTPUT_QUEUE bytes wait, the caller should drop the new frames (see isReady)
+    // and print the newest one when the terminal caught up, the cells changed since the last one printed included
+    class Renderer {
+    private:
+        Frame shown; // shown - the last frame that was printed
+        bool empty = true; // empty - nothing was printed yet
+        std::string output; // output - escape sequences of the frame being printed, written at once
+        Terminal terminal;
+
+        void moveTo(unsigned short row, unsigned short column) {
+            output += CSI;
+            output += std::to_string(row);
+            output += ';';
+            output += std::to_string(column);
+            output += CHA;
+        }
+        void style(unsigned char foreground, unsigned char background, unsigned char attribute) { // Same as ANSI::Settings::apply()
+            output += CSI "0m" CSI;
+            output += std::to_string(attribute);
+            output += "m" CSI;
+            output += std::to_string(foreground);
+            output += "m" CSI;
+            output += std::to_string(background);
+            output += 'm';
+        }
+        void cell(const Frame& frame, unsigned short y, unsigned short x) { // Print the cell [y][x] of the window
+            const Cell& cell_ = frame.cells[(std::size_t)y*frame.columns + x];
+            moveTo(y + 3, x + 2); // Same offsets as sista::Cursor::set(Coordinates)
+            style(cell_.foreground, cell_.background, cell_.attribute);
+            output += cell_.symbol;
+        }
+        void screen(const Frame& frame) { // Print the border, the rulers and all the cells of the window
+            output += CLS SSB TL;
+            std::string ruler; // The digit of each visible column
+            for (int x = frame.left; x < frame.left + frame.columns; x++)
+                ruler += (char)('0' + x % 10);
+            for (unsigned short row : {(unsigned short)2, (unsigned short)(frame.rows + 3)}) {
+                moveTo(row, 1);
+                style(ANSI::ForegroundColor::F_WHITE, ANSI::BackgroundColor::B_BLACK, ANSI::Attribute::RESET);
+                output += '&';
+                style(ANSI::ForegroundColor::F_WHITE, ANSI::BackgroundColor::B_BLACK, ANSI::Attribute::REVERSE);
+                output += ruler;
+                style(ANSI::ForegroundColor::F_WHITE, ANSI::BackgroundColor::B_BLACK, ANSI::Attribute::RESET);
+                output += '&';
+            }
+            for (unsigned short y = 0; y < frame.rows; y++) {
+                moveTo(y + 3, 1);
+                output += '&';
+                moveTo(y + 3, frame.columns + 2);
+                output += '&';
+                for (unsigned short x = 0; x < frame.columns; x++)
+                    cell(frame, y, x);
+            }
+        }
+        void hud(const Frame& frame) {
+            unsigned short column = frame.columns + 5;
+            unsigned short row = 6, spacing = 2;
+            if (frame.rows < 13) { // The terminal is too short, the HUD is compacted
+                row = 3;
+                spacing = 1;
+            }
+            style(ANSI::ForegroundColor::F_WHITE, ANSI::BackgroundColor::B_BLACK, ANSI::Attribute::BRIGHT);
+            moveTo(row, column);
+            output += "Time: " + std::to_string(frame.time) + "ms      ";
+            moveTo(row + spacing, column);
+            output += "Score: " + std::to_string(frame.score) + "      ";
+            moveTo(row + 2*spacing, column);
+            output += "Targets: " + std::to_string(frame.targets) + "      ";
+            moveTo(row + 3*spacing, column);
+            output += "Cooldown: " + std::to_string(frame.cooldown > 0 ? frame.cooldown : 0) + "      ";
+            moveTo(row + 4*spacing, column);
+            output += std::string("Selected: ") + (frame.stone ? "Stone" : "Sand") + "      ";
+            if (frame.heap) {
+                moveTo(row + 5*spacing, column);
+                output += "Heap: " + std::to_string(frame.heapLive / 1024) + "KB (peak " + std::to_string(frame.heapPeak / 1024) + "KB)      ";
+            }
+        }
+
+    public:
+        // render - print the frame, returns the number of bytes queued for the terminal
+        std::size_t render(const Frame& frame) {
+            output.clear();
+            {
+                telemetry::Scope scope(telemetry::FIELD);
+                if (empty || !frame.sameWindow(shown)) { // The window moved, everything is printed again
+                    screen(frame);
+                } else {
+                    for (unsigned short y = 0; y < frame.rows; y++)
+                        for (unsigned short x = 0; x < frame.columns; x++)
+                            if (frame.cells[(std::size_t)y*frame.columns + x] != shown.cells[(std::size_t)y*frame.columns + x])
+                                cell(frame, y, x);
+                }
+            }
+            {
+                telemetry::Scope scope(telemetry::HUD);
+                hud(frame);
+            }
+            {
+                telemetry::Scope scope(telemetry::OUTPUT);
+                terminal.write(output);
+            }
+            shown = frame; // The capacity of shown is reused
+            empty = false;
+            return output.size();
+        }
+        void flush() { // flush - write what the terminal takes of the frames printed before
+            terminal.flush();
+        }
+        bool isReady() const { // isReady - the terminal is keeping up, a new frame can be printed
+            return terminal.getPending() <= OUTPUT_QUEUE;
+        }
+        std::uint64_t getWritten() const { // getWritten - bytes written to the terminal so far
+            return terminal.getWritten();
+        }
+        std::uint64_t getQueued() const { // getQueued - bytes printed so far, written or waiting for the terminal
+            return terminal.getWritten() + terminal.getPending();
+        }
+    };
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef> // offsetof
+#include <cstring> // std::memcpy
+#include <deque> // std::deque
+#include <vector> // std::vector
+#include "state.hpp" // State, Change, journal
+
+#ifndef HISTORY_DEPTH
+    #define HISTORY_DEPTH 1000 // Steps which can be undone in the game
+#endif
+
+
+namespace rules {
+    // History - undo stack of a State, each step keeps only the cells which changed during it
+    // The cells are journaled as they're written (see rules::write), the rest of State is small enough to be copied
+    // Undoing costs as much as the changed cells, and at most depth steps are kept
+    // ⚠️ There's one journal per thread, so only one History can be marked at a time by each thread, and the State must be changed by that thread
+    class History {
+    private:
+        static constexpr std::size_t TAIL = sizeof(State) - offsetof(State, timers); // TAIL - the part of State after the cells
+
+        struct Step { // Step - how to go back to the beginning of the step
+            unsigned char tail[TAIL]; // tail - what followed the cells at the beginning of the step
+            std::vector<Change> changes; // changes - the cells written during the step, in order
+        };
+        std::deque<Step> steps; // steps - the oldest first, references stay valid when steps are added or dropped at the ends
+        std::size_t depth; // depth - maximum number of steps
+
+    public:
+        History(std::size_t depth_=HISTORY_DEPTH): depth(depth_) {}
+        ~History() {
+            clear();
+        }
+
+        // mark - a new step starts from state, the changes of the cells are journaled into it until the next mark() or undo()
+        void mark(const State& state) {
+            if (depth == 0)
+                return;
+            if (steps.size() == depth) { // The oldest step is forgotten
+                if (journal == &steps.front().changes)
+                    journal = nullptr;
+                steps.pop_front();
+            }
+            steps.emplace_back();
+            std::memcpy(steps.back().tail, (const unsigned char*)&state + offsetof(State, timers), TAIL);
+            journal = &steps.back().changes;
+        }
+        // unmark - forget the step started by the last mark(), when nothing was done after all (e.g. a key which isn't a move)
+        // ⚠️ The state must not have changed since that mark(), the changes of the step before are journaled into it again
+        // ⚠️ If that mark() forgot the oldest step (depth reached), it stays forgotten
+        void unmark() {
+            if (steps.empty())
+                return;
+            steps.pop_back();
+            journal = steps.empty() ? nullptr : &steps.back().changes;
+        }
+        // undo - take state back to the beginning of the last step, returns false if there's none
+        // The changes from now on are journaled into the step before, so a second undo() goes back to its beginning
+        bool undo(State& state) {
+            if (steps.empty())
+                return false;
+            Step& step = steps.back();
+            for (std::size_t i = step.changes.size(); i-- > 0;) // Newest first
+                state.cells[step.changes[i].cell / WIDTH][step.changes[i].cell % WIDTH] = step.changes[i].before;
+            std::memcpy((unsigned char*)&state + offsetof(State, timers), step.tail, TAIL);
+            steps.pop_back();
+            journal = steps.empty() ? nullptr : &steps.back().changes;
+            return true;
+        }
+        void clear() { // clear - forget all the steps, and stop journaling
+            journal = nullptr;
+            steps.clear();
+        }
+
+        std::size_t size() const { // size - number of steps which can be undone
+            return steps.size();
+        }
+    };
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <string> // std::string, std::to_string
+#include <vector> // std::vector
+#include <utility> // std::pair
+#include <fstream> // std::ofstream
+#include <algorithm> // std::max
+#include <stdexcept> // std::runtime_error
+#include "telemetry.hpp" // telemetry::Histogram
+
+#ifndef LATENCY_KEYS
+    #define LATENCY_KEYS 256 // Keys whose read time is kept until a frame shows them
+#endif
+
+
+// How long the keys take to show up, from the read of each key to the write of its effect to the terminal (see FULLKNING_LATENCY)
+// The keys are numbered as they're applied and each frame carries how many were applied before it was captured,
+// so the frame printed after some dropped ones accounts for the keys those showed first
+namespace latency {
+    enum Stage : unsigned char {
+        APPLIED = 0, // APPLIED - the key was applied to the state (rules::press) [game thread]
+        CAPTURED = 1, // CAPTURED - a frame showing it was captured [game thread]
+        DISPLAYED = 2, // DISPLAYED - the last byte of that frame was written to the terminal [render thread]
+        STAGES = 3
+    };
+    const char* const NAMES[STAGES] = {"applied", "captured", "displayed"};
+
+    bool enabled = false; // enabled - the keys are followed, set before the threads start
+    telemetry::Histogram histograms[STAGES]; // histograms[stage] - nanoseconds from the read of each key to the stage
+    std::atomic<std::uint64_t> reads[LATENCY_KEYS]; // reads[key % LATENCY_KEYS] - when the key was read
+    std::atomic<std::uint64_t> applied{0}; // applied - keys applied since the game started
+    std::uint64_t captured = 0; // captured - keys shown by a frame already [game thread]
+
+    std::uint64_t now() { // now - nanoseconds of the steady clock
+        return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // reach - the keys from first to last (excluded) reached the stage now, the ones which aren't kept anymore are skipped
+    void reach(Stage stage, std::uint64_t first, std::uint64_t last) {
+        std::uint64_t time = now();
+        for (std::uint64_t key = std::max(first, last > LATENCY_KEYS ? last - LATENCY_KEYS : 0); key < last; key++)
+            histograms[stage].record(time - reads[key % LATENCY_KEYS].load(std::memory_order_acquire));
+    }
+    void apply(std::uint64_t read) { // apply - the key read at read (see now()) was applied [game thread]
+        if (!enabled)
+            return;
+        std::uint64_t key = applied.load(std::memory_order_relaxed);
+        reads[key % LATENCY_KEYS].store(read, std::memory_order_release);
+        applied.store(key + 1, std::memory_order_release);
+        reach(APPLIED, key, key + 1);
+    }
+    // capture - a frame showing the keys applied so far was captured, returns their number for the frame [game thread]
+    std::uint64_t capture() {
+        std::uint64_t keys = applied.load(std::memory_order_relaxed);
+        if (enabled && keys > captured)
+            reach(CAPTURED, captured, keys);
+        captured = keys;
+        return keys;
+    }
+
+    // Display - follows the printed frames into the terminal [render thread]
+    class Display {
+    private:
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> marks; // marks - the bytes queued with each frame showing new keys, and its keys
+        std::uint64_t shown = 0; // shown - keys already on the terminal
+
+    public:
+        // printed - the frame showing keys was queued, queued bytes were queued for the terminal until then
+        void printed(std::uint64_t queued, std::uint64_t keys) {
+            if (enabled && keys > (marks.empty() ? shown : marks.back().second))
+                marks.emplace_back(queued, keys);
+        }
+        void written(std::uint64_t written_) { // written - written_ bytes were written to the terminal until now
+            std::size_t done = 0;
+            for (; done < marks.size() && marks[done].first <= written_; done++) {
+                reach(DISPLAYED, shown, marks[done].second);
+                shown = marks[done].second;
+            }
+            marks.erase(marks.begin(), marks.begin() + done);
+        }
+    };
+
+    // report - write the count, p50, p90, p99, max and mean in nanoseconds of each stage
+    // The file is CSV if path ends with ".csv", otherwise JSON, throws std::runtime_error if it can't be written
+    void report(const std::string& path) {
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        std::string output = csv ? "stage,count,p50_ns,p90_ns,p99_ns,max_ns,mean_ns\n" : "{\n  \"stages\": [\n";
+        for (unsigned stage = 0; stage < STAGES; stage++) {
+            const telemetry::Histogram& histogram = histograms[stage];
+            std::uint64_t values[] = {histogram.getCount(), histogram.percentile(0.5), histogram.percentile(0.9), histogram.percentile(0.99),
+                histogram.getMax(), histogram.getCount() == 0 ? 0 : histogram.getSum() / histogram.getCount()};
+            const char* const keys[] = {"count", "p50_ns", "p90_ns", "p99_ns", "max_ns", "mean_ns"};
+            output += csv ? std::string(NAMES[stage]) : "    {\"stage\": \"" + std::string(NAMES[stage]) + "\"";
+            for (unsigned i = 0; i < 6; i++)
+                output += csv ? "," + std::to_string(values[i]) : ", \"" + std::string(keys[i]) + "\": " + std::to_string(values[i]);
+            output += csv ? "\n" : (stage + 1 < STAGES ? "},\n" : "}\n  ]\n}\n");
+        }
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.write(output.data(), output.size()))
+            throw std::runtime_error("the file can't be written");
+    }
+};
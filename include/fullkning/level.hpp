@@ -0,0 +1,162 @@
+#pragma once
+
+#include <charconv> // std::from_chars
+#include <cstring> // std::strcmp
+#include <fstream> // std::ifstream
+#include <stdexcept> // std::runtime_error
+#include <string> // std::string, std::to_string
+#include <vector> // std::vector
+#include "../sista/coordinates.hpp" // Coordinates
+
+
+namespace level {
+    struct ParseError : public std::runtime_error { // ParseError - a malformed .level file, thrown with the line where it was found
+        std::size_t line; // line - 1-based line of the offending token (0 if the error is not tied to a line)
+
+        ParseError(std::size_t line_, const std::string& message): std::runtime_error(
+            line_ ? "line " + std::to_string(line_) + ": " + message : message
+        ), line(line_) {}
+    };
+
+    // Parser - single-pass tokenizer for the .level format, one "{y} {x}" pair per line, blank lines allowed
+    // Chunks can be fed as they come (pipes, generated levels), a token split between two chunks is carried over
+    class Parser {
+    private:
+        unsigned short width; // width - width of the field the targets must fit in
+        unsigned short height; // height - height of the field the targets must fit in
+        unsigned short top; // top - first row a target can be placed on (the rows above belong to the builder)
+        std::vector<bool> seen; // seen[y*width + x] - the target was already declared, duplicates are dropped
+        std::vector<sista::Coordinates> targets; // targets - targets parsed so far (and not drained yet)
+        std::string carry; // carry - partial token left at the end of the previous chunk
+        std::size_t line = 1; // line - current line of the input
+        unsigned long pair[2]; // pair - [y, x] of the target being read
+        int pending = 0; // pending - how many values of the pair were read on the current line
+
+        static bool isBlank(char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        void token(const char* begin, const char* end) { // token - handle one whitespace-delimited token
+            if (pending == 2)
+                throw ParseError(line, "unexpected '" + std::string(begin, end) + "', only one {y} {x} pair per line");
+            unsigned long value;
+            std::from_chars_result result = std::from_chars(begin, end, value);
+            if (result.ec != std::errc() || result.ptr != end)
+                throw ParseError(line, "'" + std::string(begin, end) + "' is not a valid coordinate");
+            pair[pending++] = value;
+        }
+        void newline() { // newline - close the current line, adding its target (if any)
+            if (pending == 1)
+                throw ParseError(line, "missing {x} coordinate after " + std::to_string(pair[0]));
+            if (pending == 2) {
+                if (pair[0] < top || pair[0] >= height || pair[1] >= width)
+                    throw ParseError(line, "target (" + std::to_string(pair[0]) + ", " + std::to_string(pair[1]) + ") is out of the field");
+                std::vector<bool>::reference slot = seen[pair[0]*width + pair[1]];
+                if (!slot) { // Duplicated targets would stack two VirtualBlock on the same cell
+                    slot = true;
+                    targets.emplace_back((unsigned short)pair[0], (unsigned short)pair[1]);
+                }
+            }
+            pending = 0;
+            line++;
+        }
+
+    public:
+        Parser(unsigned short width_, unsigned short height_, unsigned short top_=0): width(width_), height(height_), top(top_) {
+            seen.resize((std::size_t)width*height, false);
+        }
+
+        // ⚠️ This throws a ParseError at the first malformed token
+        void feed(const char* data, std::size_t size) { // feed - parse a chunk of the file
+            const char* end = data + size;
+            const char* cursor = data;
+            if (!carry.empty()) { // Complete the token that was split by the previous chunk
+                while (cursor != end && !isBlank(*cursor) && *cursor != '\n')
+                    cursor++;
+                carry.append(data, cursor);
+                if (cursor == end)
+                    return; // The whole chunk was part of the same token
+                token(carry.data(), carry.data() + carry.size());
+                carry.clear();
+            }
+            while (cursor != end) {
+                if (*cursor == '\n') {
+                    newline();
+                    cursor++;
+                } else if (isBlank(*cursor)) {
+                    cursor++;
+                } else {
+                    const char* begin = cursor;
+                    while (cursor != end && !isBlank(*cursor) && *cursor != '\n')
+                        cursor++;
+                    if (cursor == end) { // The token could continue in the next chunk
+                        carry.assign(begin, end);
+                        return;
+                    }
+                    token(begin, cursor);
+                }
+            }
+        }
+        void finish() { // finish - flush the last token and line (the file may not end with a newline)
+            if (!carry.empty()) {
+                token(carry.data(), carry.data() + carry.size());
+                carry.clear();
+            }
+            newline();
+        }
+
+        std::vector<sista::Coordinates>& getTargets() { // getTargets - targets parsed so far
+            return targets;
+        }
+        void drain(std::vector<sista::Coordinates>& out) { // drain - move the parsed targets out, to stream huge levels in bounded memory
+            out.swap(targets);
+            targets.clear();
+        }
+    };
+
+    struct Embedded { // Embedded - a level compiled into the binary (see levelpack.cpp and catalogue.hpp)
+        const char* name; // name - name of the level, as in levels/{name}.level
+        const unsigned short (*targets)[2]; // targets - [y, x] of each target
+        std::size_t size; // size - number of targets
+    };
+
+    template <std::size_t N>
+    const Embedded* findEmbedded(const Embedded (&catalogue)[N], const char* name) { // findEmbedded - nullptr if the level is not embedded
+        for (const Embedded& embedded : catalogue)
+            if (std::strcmp(embedded.name, name) == 0)
+                return &embedded;
+        return nullptr;
+    }
+    std::vector<sista::Coordinates> fromEmbedded(const Embedded& embedded) {
+        std::vector<sista::Coordinates> targets;
+        targets.reserve(embedded.size);
+        for (std::size_t i = 0; i < embedded.size; i++)
+            targets.emplace_back(embedded.targets[i][0], embedded.targets[i][1]);
+        return targets;
+    }
+
+    // ⚠️ This throws a std::runtime_error if the file can't be read and a ParseError if it's malformed
+    std::vector<sista::Coordinates> parseFile(const std::string& path, unsigned short width, unsigned short height, unsigned short top=0) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("the file can't be opened");
+        Parser parser(width, height, top);
+        std::streamoff size = file.seekg(0, std::ios::end) ? (std::streamoff)file.tellg() : -1;
+        if (size >= 0) { // The whole file with a single read
+            std::string buffer((std::size_t)size, '\0');
+            file.seekg(0);
+            if (!file.read(buffer.data(), buffer.size()))
+                throw std::runtime_error("the file can't be read");
+            parser.feed(buffer.data(), buffer.size());
+        } else { // Not seekable (a FIFO, /dev/stdin), streamed through the parser instead
+            file.clear();
+            char chunk[65536];
+            while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0)
+                parser.feed(chunk, (std::size_t)file.gcount());
+            if (file.bad())
+                throw std::runtime_error("the file can't be read");
+        }
+        parser.finish();
+        return std::move(parser.getTargets());
+    }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <climits> // SHRT_MIN
+#include <vector> // std::vector
+#include "state.hpp" // rules::State, rules::press, rules::tick, rules::victory, WIDTH, HEIGHT
+
+
+// Plays a level to the end through the rules, with the best score there is
+// Each block covers a single cell, but an unhook overwrites the target under the builder (row 2), so a level can't be won with
+// fewer unhooks than its targets below row 2, plus one for each column with a target on row 2 only: the solver unhooks
+// one per target, from the bottom of each column up, stopping a stone on each target below row 2 which neither is on the ground
+// nor on another block and dropping sand on the others
+namespace solver {
+    struct Solution {
+        bool solved = false; // solved - the level was won through the rules within the budgets of ticks and score
+        unsigned unhooks = 0;
+        unsigned stones = 0; // stones - unhooks of Stone
+        unsigned ticks = 0; // ticks - length of the game
+        short score = 0;
+        std::vector<char> keys; // keys - the keys pressed, 0 for a tick (if they were asked for)
+    };
+
+    // stones - how many stones the solver unhooks, for the targets below row 2 which aren't held up by the ground or by another target
+    unsigned stones(const rules::State& game) {
+        unsigned count = 0;
+        for (unsigned short y = 3; y < HEIGHT; y++)
+            for (unsigned short x = 0; x < WIDTH; x++)
+                count += (game.cells[y][x] & rules::TARGET) && y + 1 < HEIGHT && !(game.cells[y + 1][x] & (rules::TARGET | rules::BLOCK));
+        return count;
+    }
+    // best - the best score of the level, with the fewest unhooks
+    short best(const rules::State& game) {
+        short unhooks = 0;
+        for (unsigned short x = 0; x < WIDTH; x++) {
+            short below = 0; // below - uncovered targets of the column below row 2
+            for (unsigned short y = 3; y < HEIGHT; y++)
+                below += game.cells[y][x] == rules::TARGET;
+            unhooks += below > 0 ? below : game.cells[2][x] == rules::TARGET;
+        }
+        return (short)(game.score - unhooks);
+    }
+
+    // next - the key to press now towards the best score, one step at a time like a player, 0 to wait for a tick
+    // It aims at the lowest uncovered target of the nearest column, and stops the stone as it reaches it
+    template <typename Game>
+    char next(const Game& game) {
+        if (game.stone >= 0) { // Stopped on the lowest uncovered target of its column
+            unsigned short y = game.stone / WIDTH, x = game.stone % WIDTH;
+            if (!(game.cells[y][x] & rules::TARGET))
+                return 0;
+            for (y++; y < HEIGHT && !(game.cells[y][x] & rules::BLOCK); y++)
+                if (game.cells[y][x] == rules::TARGET)
+                    return 0;
+            return ' ';
+        }
+        if (game.timers.getUsed() > 0) // A block is falling
+            return 0;
+        short column = -1, target = 0, distance = WIDTH;
+        for (unsigned short x = 0; x < WIDTH; x++) {
+            short y = HEIGHT - 1;
+            while (y >= 2 && game.cells[y][x] != rules::TARGET)
+                y--;
+            short away = (short)((x + WIDTH - game.builder) % WIDTH);
+            away = away <= WIDTH / 2 ? away : (short)(WIDTH - away);
+            if (y >= 2 && away < distance)
+                column = (short)x, target = y, distance = away;
+        }
+        if (column < 0)
+            return 0;
+        if (game.builder != column) // The shortest way, the builder wraps around the field
+            return (column + WIDTH - game.builder) % WIDTH <= WIDTH / 2 ? 'd' : 'a';
+        bool stone = target > 2 && target + 1 < HEIGHT && !(game.cells[target + 1][column] & rules::BLOCK); // Any block overwrites a target on row 2
+        if (game.stoneSelected != stone)
+            return 'w';
+        return rules::cooldown(game) > 0 || game.timers.isFull() ? 0 : 's';
+    }
+    // isStuck - an uncovered target is under a block which doesn't fall, the level can't be won anymore
+    template <typename Game>
+    bool isStuck(const Game& game) {
+        if (game.timers.getUsed() > 0)
+            return false;
+        for (unsigned short x = 0; x < WIDTH; x++) {
+            bool covered = false; // There's a block above
+            for (unsigned short y = 2; y < HEIGHT; y++) {
+                if (covered && game.cells[y][x] == rules::TARGET)
+                    return true;
+                covered = covered || (game.cells[y][x] & rules::BLOCK);
+            }
+        }
+        return false;
+    }
+
+    // solve - play the level from game, for at most budget ticks and without the score going below least, recording the keys if asked
+    // It gives up (solved stays false) as soon as a block doesn't cover its target, or a budget would be exceeded
+    Solution solve(rules::State game, unsigned budget, short least=SHRT_MIN, bool recording=false) {
+        Solution solution;
+        auto press = [&](char key) {
+            rules::press(game, key);
+            if (recording)
+                solution.keys.push_back(key);
+        };
+        auto tick = [&]() { // tick - false once the budget is over
+            if (solution.ticks >= budget)
+                return false;
+            rules::tick(game);
+            solution.ticks++;
+            if (recording)
+                solution.keys.push_back(0);
+            return true;
+        };
+        for (unsigned short x = 0; x < WIDTH; x++) {
+            for (unsigned short y = HEIGHT - 1; y >= 2; y--) {
+                if (game.cells[y][x] != rules::TARGET) // Not a target, or covered already (an unhook overwrites row 2)
+                    continue;
+                if (game.score <= least) // One more unhook would take the score below the budget
+                    return solution;
+                while (game.builder != x) // The shortest way, the builder wraps around the field
+                    press((x + WIDTH - game.builder) % WIDTH <= WIDTH / 2 ? 'd' : 'a');
+                bool stone = y > 2 && y + 1 < HEIGHT && !(game.cells[y + 1][x] & rules::BLOCK); // Any block overwrites a target on row 2
+                if (game.stoneSelected != stone)
+                    press('w');
+                while (rules::cooldown(game) > 0)
+                    if (!tick())
+                        return solution;
+                press('s');
+                solution.unhooks++;
+                if (stone) {
+                    solution.stones++;
+                    while (game.stone >= 0 && game.stone != y*WIDTH + x)
+                        if (!tick())
+                            return solution;
+                    press(' ');
+                } else {
+                    while (game.timers.getUsed() > 0) // Until it lands
+                        if (!tick())
+                            return solution;
+                }
+                if (y > 2 && !(game.cells[y][x] & rules::BLOCK)) // The block stopped elsewhere, the target can't be covered this way
+                    return solution;
+            }
+        }
+        solution.solved = rules::victory(game);
+        solution.score = game.score;
+        return solution;
+    }
+};
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <cstdint> // std::uint16_t, std::uint32_t, std::uint64_t
+#include <cstring> // std::memcpy
+#include <string> // std::string
+#include <vector> // std::vector
+#include "frame.hpp" // render::Frame, render::Cell
+#ifndef _WIN32
+    #include <cerrno> // errno, EAGAIN, EWOULDBLOCK, EINTR
+    #include <fcntl.h> // fcntl, O_NONBLOCK
+    #include <sys/socket.h> // socket, bind, listen, accept, sendmsg, setsockopt
+    #include <sys/uio.h> // iovec
+    #include <sys/un.h> // sockaddr_un
+    #include <unistd.h> // close, unlink
+#endif
+
+
+// Spectators of a game, local clients of a Unix domain socket which are streamed the frames
+// Each message is a Header then its payload: a KEYFRAME is a whole frame, a DIFF the cells changed since the previous frame
+// Both begin with the HUD values; the numbers are in the byte order of the host, as the clients are on the same machine
+namespace spectate {
+    enum Type : char {
+        KEYFRAME = 'K', // KEYFRAME - HUD, top, left, rows, columns, then every cell
+        DIFF = 'D' // DIFF - HUD, number of cells, then (index, cell) for each cell which changed
+    };
+    struct Header {
+        char magic[3]; // magic - "FKS"
+        char type; // type - a Type
+        std::uint32_t size; // size - bytes of the payload
+    };
+    const char MAGIC[3] = {'F', 'K', 'S'};
+    const std::uint32_t MAX_PAYLOAD = 1 << 24; // A viewer refuses anything bigger, it's not a game
+
+    template <typename T>
+    void put(std::vector<char>& buffer, T value) {
+        buffer.insert(buffer.end(), (const char*)&value, (const char*)&value + sizeof(T));
+    }
+    template <typename T>
+    bool take(const std::vector<char>& buffer, std::size_t& offset, T& value) { // take - read the next value, false if the buffer ends first
+        if (offset + sizeof(T) > buffer.size())
+            return false;
+        std::memcpy(&value, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+    void putCell(std::vector<char>& buffer, const render::Cell& cell) {
+        const char bytes[4] = {cell.symbol, (char)cell.foreground, (char)cell.background, (char)cell.attribute};
+        buffer.insert(buffer.end(), bytes, bytes + 4);
+    }
+    bool takeCell(const std::vector<char>& buffer, std::size_t& offset, render::Cell& cell) {
+        if (offset + 4 > buffer.size())
+            return false;
+        cell.symbol = buffer[offset];
+        cell.foreground = (unsigned char)buffer[offset + 1];
+        cell.background = (unsigned char)buffer[offset + 2];
+        cell.attribute = (unsigned char)buffer[offset + 3];
+        offset += 4;
+        return true;
+    }
+    void putHud(std::vector<char>& buffer, const render::Frame& frame) {
+        put<std::int32_t>(buffer, frame.time);
+        put<std::int16_t>(buffer, frame.score);
+        put<std::uint32_t>(buffer, (std::uint32_t)frame.targets);
+        put<std::int16_t>(buffer, frame.cooldown);
+        put<std::uint8_t>(buffer, frame.stone);
+        put<std::uint8_t>(buffer, frame.heap);
+        put<std::uint64_t>(buffer, frame.heapLive);
+        put<std::uint64_t>(buffer, frame.heapPeak);
+    }
+    bool takeHud(const std::vector<char>& buffer, std::size_t& offset, render::Frame& frame) {
+        std::int32_t time;
+        std::int16_t score, cooldown;
+        std::uint32_t targets;
+        std::uint8_t stone, heap;
+        if (!take(buffer, offset, time) || !take(buffer, offset, score) || !take(buffer, offset, targets) || !take(buffer, offset, cooldown)
+            || !take(buffer, offset, stone) || !take(buffer, offset, heap) || !take(buffer, offset, frame.heapLive) || !take(buffer, offset, frame.heapPeak))
+            return false;
+        frame.time = time, frame.score = score, frame.targets = targets, frame.cooldown = cooldown;
+        frame.stone = stone != 0, frame.heap = heap != 0;
+        return true;
+    }
+
+    // encodeKeyframe - the payload of a KEYFRAME of the frame
+    void encodeKeyframe(std::vector<char>& buffer, const render::Frame& frame) {
+        buffer.clear();
+        putHud(buffer, frame);
+        for (unsigned short value : {frame.top, frame.left, frame.rows, frame.columns})
+            put<std::uint16_t>(buffer, value);
+        for (const render::Cell& cell : frame.cells)
+            putCell(buffer, cell);
+    }
+    // encodeDiff - the payload of a DIFF from previous to frame, which must show the same window
+    void encodeDiff(std::vector<char>& buffer, const render::Frame& previous, const render::Frame& frame) {
+        buffer.clear();
+        putHud(buffer, frame);
+        std::size_t count = buffer.size();
+        put<std::uint32_t>(buffer, 0);
+        std::uint32_t changed = 0;
+        for (std::uint32_t i = 0; i < (std::uint32_t)frame.cells.size(); i++)
+            if (frame.cells[i] != previous.cells[i]) {
+                put<std::uint32_t>(buffer, i);
+                putCell(buffer, frame.cells[i]);
+                changed++;
+            }
+        std::memcpy(buffer.data() + count, &changed, sizeof(changed));
+    }
+    // decode - apply the payload of a message to the frame, returns false if it's malformed (or a DIFF without a keyframe before)
+    bool decode(char type, const std::vector<char>& buffer, render::Frame& frame, bool& synced) {
+        std::size_t offset = 0;
+        render::Frame decoded = frame;
+        if (!takeHud(buffer, offset, decoded))
+            return false;
+        if (type == KEYFRAME) {
+            std::uint16_t window[4];
+            for (std::uint16_t& value : window)
+                if (!take(buffer, offset, value))
+                    return false;
+            decoded.top = window[0], decoded.left = window[1], decoded.rows = window[2], decoded.columns = window[3];
+            if (buffer.size() - offset < 4 * (std::size_t)decoded.rows * decoded.columns) // Checked before the cells are allocated
+                return false;
+            decoded.cells.resize((std::size_t)decoded.rows * decoded.columns);
+            for (render::Cell& cell : decoded.cells)
+                if (!takeCell(buffer, offset, cell))
+                    return false;
+        } else if (type == DIFF && synced) {
+            std::uint32_t changed, index;
+            if (!take(buffer, offset, changed))
+                return false;
+            for (std::uint32_t i = 0; i < changed; i++)
+                if (!take(buffer, offset, index) || index >= decoded.cells.size() || !takeCell(buffer, offset, decoded.cells[index]))
+                    return false;
+        } else {
+            return false;
+        }
+        frame = decoded;
+        synced = true;
+        return true;
+    }
+
+    #ifndef _WIN32
+        // Server - the game side, accepts the spectators and fans each frame out to them, never waiting for one
+        // A new spectator, or one which couldn't take a whole message, is sent a keyframe as soon as it's ready again,
+        // so a slow one skips frames instead of holding up the game
+        class Server {
+        private:
+            struct Client {
+                int socket;
+                bool synced = false; // synced - it has the previous frame, so it can be sent a DIFF
+                std::vector<char> pending; // pending - the end of a message it couldn't take yet
+            };
+            int listener = -1;
+            std::string path;
+            std::vector<Client> clients;
+            render::Frame previous; // previous - the last frame sent
+            bool empty = true; // empty - no frame was sent yet
+            std::vector<char> keyframe, diff; // The payloads of the current frame, encoded once for all the clients
+
+            // send - write the header and the payload with a single sendmsg, returns false if the client is gone
+            // What doesn't fit in the socket is kept as pending
+            bool send(Client& client, char type, const std::vector<char>& payload) {
+                Header header = {{MAGIC[0], MAGIC[1], MAGIC[2]}, type, (std::uint32_t)payload.size()};
+                iovec parts[2] = {{&header, sizeof(Header)}, {(void*)payload.data(), payload.size()}};
+                msghdr message = {};
+                message.msg_iov = parts;
+                message.msg_iovlen = 2;
+                ssize_t sent = sendmsg(client.socket, &message, flags());
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                    sent = 0;
+                if (sent < 0)
+                    return false;
+                if ((std::size_t)sent < sizeof(Header) + payload.size()) { // The rest waits, and the client misses frames until it's sent
+                    std::vector<char> whole((const char*)&header, (const char*)&header + sizeof(Header));
+                    whole.insert(whole.end(), payload.begin(), payload.end());
+                    client.pending.assign(whole.begin() + sent, whole.end());
+                    client.synced = false;
+                }
+                return true;
+            }
+            static int flags() {
+                #ifdef MSG_NOSIGNAL
+                    return MSG_NOSIGNAL | MSG_DONTWAIT; // A spectator closing its end mustn't kill the game with SIGPIPE
+                #else
+                    return MSG_DONTWAIT; // SO_NOSIGPIPE is set on the socket instead
+                #endif
+            }
+
+        public:
+            Server() {}
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+            ~Server() {
+                close();
+            }
+
+            // open - listen on the socket at path_ (a stale one is replaced), returns false if it can't
+            bool open(const std::string& path_) {
+                close();
+                sockaddr_un address = {};
+                address.sun_family = AF_UNIX;
+                if (path_.size() >= sizeof(address.sun_path))
+                    return false;
+                std::memcpy(address.sun_path, path_.c_str(), path_.size() + 1);
+                listener = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (listener < 0)
+                    return false;
+                unlink(path_.c_str());
+                if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+                    ::close(listener);
+                    listener = -1;
+                    return false;
+                }
+                fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+                path = path_;
+                return true;
+            }
+            void close() {
+                for (Client& client : clients)
+                    ::close(client.socket);
+                clients.clear();
+                if (listener < 0)
+                    return;
+                ::close(listener);
+                unlink(path.c_str());
+                listener = -1;
+            }
+
+            // broadcast - accept the new spectators, then send them the frame [the render thread, as soon as it has the frame, before printing it]
+            void broadcast(const render::Frame& frame) {
+                if (listener < 0)
+                    return;
+                int socket_;
+                while ((socket_ = accept(listener, nullptr, nullptr)) >= 0) {
+                    fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK);
+                    #ifdef SO_NOSIGPIPE
+                        int on = 1;
+                        setsockopt(socket_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+                    #endif
+                    clients.push_back(Client{socket_, false, {}});
+                }
+                bool window = !empty && frame.sameWindow(previous); // The DIFF can be encoded
+                bool encodedKeyframe = false, encodedDiff = false;
+                for (std::size_t i = 0; i < clients.size();) {
+                    Client& client = clients[i];
+                    bool alive = true;
+                    if (!client.pending.empty()) {
+                        ssize_t sent = ::send(client.socket, client.pending.data(), client.pending.size(), flags());
+                        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                            alive = false;
+                        else if (sent > 0)
+                            client.pending.erase(client.pending.begin(), client.pending.begin() + sent);
+                    }
+                    if (alive && client.pending.empty()) {
+                        if (client.synced && window) {
+                            if (!encodedDiff)
+                                encodeDiff(diff, previous, frame), encodedDiff = true;
+                            alive = send(client, DIFF, diff);
+                        } else {
+                            if (!encodedKeyframe)
+                                encodeKeyframe(keyframe, frame), encodedKeyframe = true;
+                            client.synced = true; // Unless the keyframe doesn't fit whole
+                            alive = send(client, KEYFRAME, keyframe);
+                        }
+                    } else if (alive) { // Still behind, this frame is skipped
+                        client.synced = false;
+                    }
+                    if (alive) {
+                        i++;
+                    } else {
+                        ::close(client.socket);
+                        clients.erase(clients.begin() + i);
+                    }
+                }
+                previous = frame;
+                empty = false;
+            }
+
+            std::size_t getClients() const {
+                return clients.size();
+            }
+            bool isOpen() const {
+                return listener >= 0;
+            }
+        };
+    #else
+        class Server { // Unix domain sockets aren't used on Windows, nobody can spectate
+        public:
+            bool open(const std::string&) {
+                return false;
+            }
+            void close() {}
+            void broadcast(const render::Frame&) {}
+            std::size_t getClients() const {
+                return 0;
+            }
+            bool isOpen() const {
+                return false;
+            }
+        };
+    #endif
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstring> // std::memset, std::memcmp
+#include <string> // std::string
+#include <vector> // std::vector
+#include <fstream> // std::ifstream, std::ofstream
+#include <stdexcept> // std::runtime_error
+#include <type_traits> // std::is_trivially_copyable
+#include "../sista/coordinates.hpp" // Coordinates
+#include "timer_wheel.hpp" // TimerWheel
+
+#define WIDTH 10
+#define HEIGHT 20
+#define COOLDOWN 3 // Ticks between two unhooks
+#ifndef SAND_PERIOD
+    #define SAND_PERIOD 1 // Ticks a sand block takes to fall by one cell
+#endif
+#ifndef STONE_PERIOD
+    #define STONE_PERIOD 1 // Ticks the stone block takes to fall by one cell
+#endif
+#define MAX_FALLING ((HEIGHT*SAND_PERIOD + COOLDOWN - 1) / COOLDOWN + 1) // A sand block falls for less than HEIGHT*SAND_PERIOD ticks, one is unhooked every COOLDOWN ticks
+
+
+namespace rules {
+    enum Cell : unsigned char { // Cell - what's on a cell of the field, a block and a target can be on the same cell
+        EMPTY = 0,
+        SAND = 1,
+        STONE = 2,
+        BLOCK = 3, // BLOCK - mask of the block
+        TARGET = 4 // TARGET - the target is visible only if there's no block on it
+    };
+
+    struct Body { // Body - a falling block, the event of its timer
+        unsigned short cell; // cell - y*WIDTH + x
+        unsigned char block; // block - SAND or STONE
+    };
+    // Timers - a timer per falling block, due when the block falls by one cell
+    // The sand blocks, then the stone block, and one more for a stopped stone block whose timer isn't due yet
+    typedef TimerWheel<Body, MAX_FALLING + 2> Timers;
+
+    // State - the whole game, in a fixed layout without pointers, so that copying it is a memcpy
+    struct State {
+        unsigned char cells[HEIGHT][WIDTH]; // cells[y][x] - a Cell, rows 0 and 1 belong to the builder
+        Timers timers; // timers - the falling blocks, a tick touches only those due then
+        short stone; // stone - cell of the falling stone block, -1 if there's none
+        unsigned short stoneTimer; // stoneTimer - the timer of the falling stone block
+        unsigned char builder; // builder - column of the builder, which is on row 1
+        bool stoneSelected; // stoneSelected - the builder unhooks Stone (otherwise Sand)
+        short score;
+        unsigned int ready; // ready - tick from which the builder can unhook again, the cooldown is never counted down
+        unsigned short targets; // targets - number of targets of the level
+        unsigned short uncovered; // uncovered - number of targets without a block on them, 0 is the victory
+        unsigned int ticks; // ticks - ticks since the level started
+    };
+    static_assert(std::is_trivially_copyable<State>::value, "State must be copied with a memcpy");
+
+    struct Change { // Change - a cell which was changed, with what it was before
+        unsigned short cell; // cell - y*WIDTH + x
+        unsigned char before;
+    };
+    // journal - if set, each change of a cell made by this thread is appended to it (see History)
+    // ⚠️ One per thread, so the threads of env::Batch never append to the History of the game
+    thread_local std::vector<Change>* journal = nullptr;
+
+    // The rules are templates, so that they work on a State and on anything with the same members (see env::Batch)
+
+    template <typename Game>
+    void write(Game& game, unsigned short cell, unsigned char value) { // write - all the changes of the cells go through here
+        unsigned char& current = game.cells[cell / WIDTH][cell % WIDTH];
+        if (journal != nullptr && current != value)
+            journal->push_back(Change{cell, current});
+        game.uncovered += (value == TARGET) - (current == TARGET);
+        current = value;
+    }
+
+    // start - the state of a level at its beginning
+    void start(State& state, const std::vector<sista::Coordinates>& targets) {
+        std::memset(&state, 0, sizeof(State));
+        for (const sista::Coordinates& coordinates : targets)
+            state.cells[coordinates.y][coordinates.x] = TARGET;
+        for (unsigned short y = 0; y < HEIGHT; y++) // Duplicated targets are counted once
+            for (unsigned short x = 0; x < WIDTH; x++)
+                state.uncovered += state.cells[y][x] == TARGET;
+        state.timers.clear();
+        state.stone = -1;
+        state.stoneTimer = Timers::NONE;
+        state.builder = WIDTH / 2;
+        state.targets = (unsigned short)targets.size();
+        state.score = (short)(targets.size() * 3);
+    }
+
+    // fall - move the block on the cell one cell down, returns false if it can't (so it's no more falling)
+    // A target under the block is left where it was, and one under the new cell stays under the block
+    template <typename Game>
+    bool fall(Game& game, unsigned short& cell) {
+        unsigned short y = cell / WIDTH, x = cell % WIDTH;
+        if (y + 1 >= HEIGHT || (game.cells[y + 1][x] & BLOCK)) // The ground or another block
+            return false;
+        write(game, cell + WIDTH, game.cells[y + 1][x] | (game.cells[y][x] & BLOCK));
+        write(game, cell, game.cells[y][x] & TARGET);
+        cell += WIDTH;
+        return true;
+    }
+    // The phases of a tick, see tick()
+    // advance - the tick begins, the timers due are copied into due[Timers::SIZE], returns how many they are
+    template <typename Game>
+    unsigned char advance(Game& game, unsigned short* due) {
+        game.ticks++;
+        unsigned char count = 0;
+        for (unsigned short timer = game.timers.advance(); timer != Timers::NONE; timer = game.timers.next(timer))
+            due[count++] = timer; // Rescheduling a timer changes its next, so the list is copied first
+        return count;
+    }
+    // fallSand - the sand blocks which are due fall, in the order they were unhooked
+    // The timers due at the same tick come in the order they were scheduled
+    template <typename Game>
+    void fallSand(Game& game, const unsigned short* due, unsigned char count) {
+        for (unsigned char i = 0; i < count; i++) {
+            Body& body = game.timers.get(due[i]);
+            if (body.block != SAND)
+                continue;
+            if (fall(game, body.cell))
+                game.timers.reschedule(due[i], SAND_PERIOD);
+            else
+                game.timers.release(due[i]);
+        }
+    }
+    // fallStone - the stone block falls if it's due
+    template <typename Game>
+    void fallStone(Game& game, const unsigned short* due, unsigned char count) {
+        for (unsigned char i = 0; i < count; i++) {
+            Body& body = game.timers.get(due[i]);
+            if (body.block != STONE)
+                continue;
+            if (fall(game, body.cell)) {
+                game.timers.reschedule(due[i], STONE_PERIOD);
+                game.stone = body.cell;
+            } else {
+                game.timers.release(due[i]);
+                game.stone = -1;
+                game.stoneTimer = Timers::NONE;
+            }
+        }
+    }
+    // tick - what happens every tick: the sand blocks which are due fall, then the stone block if it's due
+    template <typename Game>
+    void tick(Game& game) {
+        unsigned short due[Timers::SIZE];
+        unsigned char count = advance(game, due);
+        fallSand(game, due, count);
+        fallStone(game, due, count);
+    }
+    template <typename Game>
+    unsigned int cooldown(const Game& game) { // cooldown - ticks before the builder can unhook again
+        return game.ready > game.ticks ? game.ready - game.ticks : 0;
+    }
+
+    // unhook - the builder drops the selected block under itself, overwriting what's there
+    template <typename Game>
+    void unhook(Game& game) {
+        if (cooldown(game) > 0 || game.timers.isFull())
+            return;
+        unsigned short cell = 2*WIDTH + game.builder;
+        if (!game.stoneSelected) {
+            game.timers.schedule(SAND_PERIOD, Body{cell, SAND});
+            write(game, cell, SAND);
+        } else {
+            if (game.stone >= 0) // Only one stone block can fall at a time
+                return;
+            game.stoneTimer = game.timers.schedule(STONE_PERIOD, Body{cell, STONE});
+            game.stone = cell;
+            write(game, cell, STONE);
+        }
+        game.score--;
+        game.ready = game.ticks + COOLDOWN;
+    }
+    // press - apply a key of the game (w, a, d, s, space), returns false if it's not one of them
+    template <typename Game>
+    bool press(Game& game, char key) {
+        switch (key) {
+            case 'w': case 'W':
+                game.stoneSelected = !game.stoneSelected;
+                break;
+            case 'a': case 'A': // The builder wraps around the field [PACMAN_EFFECT]
+                game.builder = (game.builder + WIDTH - 1) % WIDTH;
+                break;
+            case 'd': case 'D':
+                game.builder = (game.builder + 1) % WIDTH;
+                break;
+            case 's': case 'S':
+                unhook(game);
+                break;
+            case ' ': // The falling stone block stops where it is
+                if (game.stone >= 0)
+                    game.timers.cancel(game.stoneTimer);
+                game.stone = -1;
+                game.stoneTimer = Timers::NONE;
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    template <typename Game>
+    bool victory(const Game& game) { // victory - no target is left uncovered
+        return game.uncovered == 0;
+    }
+
+    // Snapshot file: "FKSTATE", the size of the field and of State, then the bytes of State
+    const char MAGIC[8] = "FKSTATE";
+    struct Header {
+        char magic[8];
+        unsigned short width, height;
+        unsigned int size;
+    };
+
+    // save - write a snapshot of the state, throws std::runtime_error if it can't
+    void save(const State& state, const std::string& path) {
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.width = WIDTH, header.height = HEIGHT, header.size = sizeof(State);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.write((const char*)&header, sizeof(Header)) || !file.write((const char*)&state, sizeof(State)))
+            throw std::runtime_error("the file can't be written");
+    }
+    // load - read a snapshot of the state, returns false if there's no file, throws std::runtime_error if it's not a valid snapshot
+    bool load(State& state, const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+        Header header;
+        State loaded;
+        if (!file.read((char*)&header, sizeof(Header)) || !file.read((char*)&loaded, sizeof(State)))
+            throw std::runtime_error("the snapshot is truncated");
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.width != WIDTH || header.height != HEIGHT || header.size != sizeof(State))
+            throw std::runtime_error("the snapshot was saved by another version of the game");
+        bool corrupted = loaded.builder >= WIDTH || loaded.stone >= WIDTH*HEIGHT || (loaded.stone >= 0 && loaded.stoneTimer >= MAX_FALLING + 2);
+        corrupted = corrupted || !loaded.timers.isConsistent([](const Body& body) {
+            return body.cell < WIDTH*HEIGHT && (body.block == SAND || body.block == STONE);
+        });
+        unsigned short uncovered = 0;
+        for (unsigned short y = 0; y < HEIGHT; y++)
+            for (unsigned short x = 0; x < WIDTH; x++)
+                uncovered += loaded.cells[y][x] == TARGET;
+        corrupted = corrupted || uncovered != loaded.uncovered;
+        if (corrupted)
+            throw std::runtime_error("the snapshot is corrupted");
+        state = loaded;
+        return true;
+    }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t, std::uint32_t
+#include <cstring> // std::memcpy, std::memcmp
+#include <string> // std::string, std::to_string
+#include <atomic> // std::atomic, std::atomic_thread_fence
+#include <new> // placement new
+#ifndef _WIN32
+    #include <fcntl.h> // O_CREAT, O_RDWR, O_RDONLY
+    #include <sys/mman.h> // shm_open, shm_unlink, mmap, munmap
+    #include <sys/stat.h> // fstat
+    #include <unistd.h> // ftruncate, close, getpid
+#endif
+
+#ifndef STATS_SLOTS
+    #define STATS_SLOTS 256 // Samples kept in the ring, one per tick
+#endif
+
+
+// Live counters of a running game in shared memory (/dev/shm/fullkning.<pid> on Linux), for a monitor in another process
+// The game only writes into the mapping, the readers (see fullkstat.cpp) sample it without a system call into the game
+// Not available on Windows, where Publisher does nothing
+namespace stats {
+    struct Sample { // Sample - the counters after a tick
+        std::uint64_t tick; // tick - ticks since the level started
+        std::uint64_t duration; // duration - nanoseconds taken by the tick (the blocks falling and the frame capture)
+        std::uint64_t falling; // falling - blocks falling
+        std::uint64_t uncovered; // uncovered - targets remaining
+        std::uint64_t output; // output - bytes written to the terminal since the game started
+        std::uint64_t allocations; // allocations - heap allocations since the game started
+    };
+    const unsigned FIELDS = sizeof(Sample) / sizeof(std::uint64_t);
+
+    // Slot - a sample behind a seqlock: its sequence is odd while the sample is written
+    // The fields are relaxed atomics, so a reader racing with the writer gets a torn copy and not undefined behaviour, and retries
+    struct Slot {
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint64_t> fields[FIELDS];
+    };
+
+    // Shared - the layout of the mapping, fixed so that any build of the reader can check it
+    const char MAGIC[8] = "FKSTATS";
+    struct Shared {
+        char magic[8];
+        std::uint32_t size; // size - sizeof(Shared) of the writer
+        std::uint32_t slots; // slots - STATS_SLOTS of the writer
+        std::uint64_t pid;
+        std::atomic<std::uint64_t> written; // written - samples published, the newest is in slot (written - 1) % slots
+        Slot ring[STATS_SLOTS];
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+        "the atomics are shared with another process, they can't hide a lock");
+
+    std::string path(std::uint64_t pid) { // path - name of the shared memory of the game with the pid, for shm_open
+        return "/fullkning." + std::to_string(pid);
+    }
+
+    // Publisher - the game side, creates the shared memory and writes a sample per tick into the ring
+    class Publisher {
+    private:
+        Shared* shared = nullptr; // shared - nullptr if the shared memory couldn't be created
+        std::string name;
+
+    public:
+        Publisher() {}
+        Publisher(const Publisher&) = delete;
+        Publisher& operator=(const Publisher&) = delete;
+        ~Publisher() {
+            close();
+        }
+
+        // open - create the shared memory of this process, returns false if it can't
+        bool open() {
+            #ifndef _WIN32
+                close();
+                name = path((std::uint64_t)getpid());
+                int descriptor = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+                if (descriptor < 0)
+                    return false;
+                void* mapping = MAP_FAILED;
+                if (ftruncate(descriptor, sizeof(Shared)) == 0)
+                    mapping = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+                ::close(descriptor); // The mapping stays
+                if (mapping == MAP_FAILED) {
+                    shm_unlink(name.c_str());
+                    return false;
+                }
+                shared = new (mapping) Shared(); // Zeroed, as the file was
+                shared->size = sizeof(Shared);
+                shared->slots = STATS_SLOTS;
+                shared->pid = (std::uint64_t)getpid();
+                std::atomic_thread_fence(std::memory_order_release);
+                std::memcpy(shared->magic, MAGIC, sizeof(MAGIC)); // Last, a reader checks it first
+                return true;
+            #else
+                return false;
+            #endif
+        }
+        void close() { // close - remove the shared memory, the readers which mapped it keep their copy
+            #ifndef _WIN32
+                if (shared == nullptr)
+                    return;
+                munmap(shared, sizeof(Shared));
+                shm_unlink(name.c_str());
+                shared = nullptr;
+            #endif
+        }
+
+        // publish - write the sample into the next slot of the ring [one writer]
+        void publish(const Sample& sample) {
+            if (shared == nullptr)
+                return;
+            std::uint64_t written = shared->written.load(std::memory_order_relaxed);
+            Slot& slot = shared->ring[written % STATS_SLOTS];
+            std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed); // Odd, being written
+            std::atomic_thread_fence(std::memory_order_release);
+            std::uint64_t fields[FIELDS];
+            std::memcpy(fields, &sample, sizeof(Sample));
+            for (unsigned i = 0; i < FIELDS; i++)
+                slot.fields[i].store(fields[i], std::memory_order_relaxed);
+            slot.sequence.store(sequence + 2, std::memory_order_release); // Even, written
+            shared->written.store(written + 1, std::memory_order_release);
+        }
+        bool isOpen() const {
+            return shared != nullptr;
+        }
+    };
+
+    // read - copy the sample of the slot, returns false if the writer was writing it (then try again)
+    bool read(const Slot& slot, Sample& sample) {
+        std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            return false;
+        std::uint64_t fields[FIELDS];
+        for (unsigned i = 0; i < FIELDS; i++)
+            fields[i] = slot.fields[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before)
+            return false;
+        std::memcpy(&sample, fields, sizeof(Sample));
+        return true;
+    }
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint> // std::uint64_t
+#include <csignal> // std::signal, std::sig_atomic_t, SIGUSR1
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <string> // std::string
+#include <vector> // std::vector
+#include <utility> // std::pair
+#include <sstream> // std::ostringstream
+#include <fstream> // std::ofstream
+#include <algorithm> // std::min, std::sort
+#include <stdexcept> // std::runtime_error
+#include "trace.hpp" // trace::span
+
+
+namespace telemetry {
+    enum Phase : unsigned char { // Phase - a timed part of a tick
+        INPUT = 0, // INPUT - a key is applied
+        SAND = 1, // SAND - the timers due, then the sand blocks fall (rules::advance, rules::fallSand)
+        STONE = 2, // STONE - the stone block falls (rules::fallStone)
+        VICTORY = 3, // VICTORY - rules::victory
+        CAPTURE = 4, // CAPTURE - the frame is filled from the state
+        FIELD = 5, // FIELD - the changed cells of the field are turned into escape sequences [render thread]
+        HUD = 6, // HUD - the same for the HUD [render thread]
+        OUTPUT = 7, // OUTPUT - the frame is written to the terminal [render thread]
+        PHASES = 8
+    };
+    const char* const NAMES[PHASES] = {"input", "sand", "stone", "victory", "capture", "field", "hud", "output"};
+
+    // Histogram - lock-free histogram of durations in nanoseconds, in the way of HdrHistogram
+    // Values below 2*SUB have a bucket each, above them each power of two is split in SUB buckets, so a bucket is at most 1/SUB of its values
+    class Histogram {
+    private:
+        static constexpr unsigned SUB = 16;
+        static constexpr unsigned BUCKETS = 2*SUB + 40*SUB; // Up to 2^45 ns (almost 10 hours), longer ones share the last bucket
+
+        std::atomic<std::uint64_t> buckets[BUCKETS] = {};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum{0};
+        std::atomic<std::uint64_t> max{0};
+
+        static unsigned bucket(std::uint64_t value) { // bucket - index of the bucket of the value
+            if (value < 2*SUB)
+                return (unsigned)value;
+            #if defined(__GNUC__) || defined(__clang__)
+                unsigned shift = 64 - __builtin_clzll(value) - 5; // The top 5 bits of the value are kept
+            #else
+                unsigned shift = 0;
+                while ((value >> shift) >= 2*SUB)
+                    shift++;
+            #endif
+            return std::min(BUCKETS - 1, 2*SUB + (shift - 1)*SUB + (unsigned)(value >> shift) - SUB);
+        }
+        static std::uint64_t lowest(unsigned index) { // lowest - smallest value of the bucket
+            if (index < 2*SUB)
+                return index;
+            unsigned shift = (index - 2*SUB) / SUB + 1;
+            return (std::uint64_t)(SUB + (index - 2*SUB) % SUB) << shift;
+        }
+
+    public:
+        void record(std::uint64_t value) { // record - add a duration, from any thread
+            buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(value, std::memory_order_relaxed);
+            std::uint64_t current = max.load(std::memory_order_relaxed);
+            while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed));
+        }
+
+        // percentile - the duration which fraction of the recorded ones don't exceed (middle of its bucket, at most the maximum)
+        std::uint64_t percentile(double fraction) const {
+            std::uint64_t total = count.load(std::memory_order_relaxed);
+            if (total == 0)
+                return 0;
+            std::uint64_t rank = (std::uint64_t)(fraction * total + 0.5), seen = 0;
+            for (unsigned i = 0; i < BUCKETS; i++) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank && seen > 0)
+                    return std::min(getMax(), (lowest(i) + (i + 1 < BUCKETS ? lowest(i + 1) : lowest(i) + 1) - 1) / 2);
+            }
+            return getMax();
+        }
+        std::uint64_t getCount() const {
+            return count.load(std::memory_order_relaxed);
+        }
+        std::uint64_t getSum() const {
+            return sum.load(std::memory_order_relaxed);
+        }
+        std::uint64_t getMax() const {
+            return max.load(std::memory_order_relaxed);
+        }
+    };
+
+    Histogram histograms[PHASES]; // histograms[phase] - the durations of the phase since the game started
+    std::atomic<std::uint64_t> dropped{0}; // dropped - frames never printed because the render thread or the terminal was too slow [game and render threads]
+
+    // Scope - times its own lifetime as a phase, and records it as a span of the timeline with FULLKNING_TRACE (see trace.hpp)
+    // Compile with FULLKNING_NO_TELEMETRY and without FULLKNING_TRACE and it does nothing
+    class Scope {
+    private:
+        #if !defined(FULLKNING_NO_TELEMETRY) || defined(FULLKNING_TRACE)
+            Phase phase;
+            std::chrono::steady_clock::time_point start;
+        #endif
+
+    public:
+        #if !defined(FULLKNING_NO_TELEMETRY) || defined(FULLKNING_TRACE)
+            Scope(Phase phase_): phase(phase_), start(std::chrono::steady_clock::now()) {}
+            ~Scope() {
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+                #ifndef FULLKNING_NO_TELEMETRY
+                    histograms[phase].record((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                #endif
+                #ifdef FULLKNING_TRACE
+                    trace::span(NAMES[phase], start, end);
+                #endif
+            }
+        #else
+            Scope(Phase) {}
+        #endif
+    };
+
+    // clockCost - median nanoseconds of a measure (two reads of the clock), to tell what the telemetry costs
+    std::uint64_t clockCost() {
+        std::uint64_t costs[101];
+        for (std::uint64_t& cost : costs) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            cost = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::sort(costs, costs + 101);
+        return 2*costs[50]; // A read of the clock each
+    }
+
+    // Table - more figures for the report, a row per name with a value per column (e.g. the allocations by subsystem)
+    struct Table {
+        std::string name;
+        std::vector<std::string> columns;
+        std::vector<std::pair<std::string, std::vector<double>>> rows;
+    };
+
+    // report - write the count, p50, p90, p99, max and mean of each phase in nanoseconds, the dropped frames, then the table if it has rows
+    // The file is CSV if path ends with ".csv" (the dropped frames and the table follow after an empty line), otherwise JSON
+    // Throws std::runtime_error if it can't be written
+    void report(const std::string& path, const Table& table=Table()) {
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        std::uint64_t measures = 0, measured = 0;
+        for (const Histogram& histogram : histograms)
+            measures += histogram.getCount(), measured += histogram.getSum();
+        std::string output = csv ? "phase,count,p50_ns,p90_ns,p99_ns,max_ns,mean_ns\n" : "{\n  \"phases\": [\n";
+        for (unsigned phase = 0; phase < PHASES; phase++) {
+            const Histogram& histogram = histograms[phase];
+            std::uint64_t values[] = {histogram.getCount(), histogram.percentile(0.5), histogram.percentile(0.9), histogram.percentile(0.99),
+                histogram.getMax(), histogram.getCount() == 0 ? 0 : histogram.getSum() / histogram.getCount()};
+            const char* const keys[] = {"count", "p50_ns", "p90_ns", "p99_ns", "max_ns", "mean_ns"};
+            output += csv ? std::string(NAMES[phase]) : "    {\"phase\": \"" + std::string(NAMES[phase]) + "\"";
+            for (unsigned i = 0; i < 6; i++)
+                output += csv ? "," + std::to_string(values[i]) : ", \"" + std::string(keys[i]) + "\": " + std::to_string(values[i]);
+            output += csv ? "\n" : (phase + 1 < PHASES ? "},\n" : "}\n");
+        }
+        if (!csv) { // The cost of the telemetry itself, to compare with measured_ns
+            output += "  ],\n  \"measured_ns\": " + std::to_string(measured);
+            output += ",\n  \"overhead_ns\": " + std::to_string(measures * clockCost());
+        }
+        output += (csv ? "\ndropped_frames," : ",\n  \"dropped_frames\": ") + std::to_string(dropped.load(std::memory_order_relaxed));
+        output += csv ? "\n" : "";
+        if (!table.rows.empty()) {
+            std::ostringstream values; // Shortest form of the numbers, without trailing zeros
+            values.precision(15); // Counts of bytes are printed whole
+            values << (csv ? "\n" + table.name : ",\n  \"" + table.name + "\": [\n");
+            for (const std::string& column : table.columns)
+                values << (csv ? "," + column : "");
+            values << (csv ? "\n" : "");
+            for (std::size_t row = 0; row < table.rows.size(); row++) {
+                values << (csv ? table.rows[row].first : "    {\"name\": \"" + table.rows[row].first + "\"");
+                for (std::size_t i = 0; i < table.columns.size() && i < table.rows[row].second.size(); i++)
+                    values << (csv ? "," : ", \"" + table.columns[i] + "\": ") << table.rows[row].second[i];
+                values << (csv ? "\n" : (row + 1 < table.rows.size() ? "},\n" : "}\n  ]"));
+            }
+            output += values.str();
+        }
+        if (!csv)
+            output += "\n}\n";
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.write(output.data(), output.size()))
+            throw std::runtime_error("the file can't be written");
+    }
+
+    // The report can be asked for while the game runs, with SIGUSR1 (not on Windows)
+    volatile std::sig_atomic_t requested = 0;
+    void listen() { // listen - handle SIGUSR1 from now on
+        #ifdef SIGUSR1
+            std::signal(SIGUSR1, [](int) {
+                requested = 1;
+            });
+        #endif
+    }
+    bool isRequested() { // isRequested - a report was asked for since the last call
+        if (!requested)
+            return false;
+        requested = 0;
+        return true;
+    }
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+
+// TimerWheel - hierarchical timing wheel with room for CAPACITY timers, each carrying an Event
+// LEVELS wheels of 2^BITS slots: a timer waits in the lowest wheel whose span covers its due tick, and
+// moves down a level when the wheel above reaches its slot, so each tick only touches the timers due then
+// Timers are linked by index in fixed arrays, so the wheel is trivially copyable and can live in a State
+template <typename Event, unsigned short CAPACITY, unsigned BITS=4, unsigned LEVELS=2>
+class TimerWheel {
+public:
+    static constexpr unsigned short NONE = 0xFFFF; // NONE - no timer (end of a list, or a full wheel)
+    static constexpr unsigned short SIZE = CAPACITY; // SIZE - maximum number of timers, and of timers due at once
+
+private:
+    static constexpr unsigned SLOTS = 1u << BITS;
+
+    struct Timer {
+        Event event;
+        unsigned int due; // due - the tick the timer fires at
+        unsigned short next; // next - the next timer in the same slot (or in the free list)
+        bool cancelled;
+    };
+    Timer timers[CAPACITY];
+    unsigned short heads[LEVELS][SLOTS]; // heads[level][slot] - first timer of the slot, in the order they were scheduled
+    unsigned short tails[LEVELS][SLOTS]; // tails[level][slot] - last timer of the slot
+    unsigned short free; // free - first unused timer
+    unsigned short used; // used - number of timers scheduled
+    unsigned int now; // now - the current tick
+
+    void insert(unsigned short timer) { // insert - put the timer in the slot of its due tick
+        unsigned level = 0;
+        while (level + 1 < LEVELS && (timers[timer].due >> (BITS*(level + 1))) != (now >> (BITS*(level + 1))))
+            level++; // Not in the span of this wheel, the top wheel takes the rest and sorts it out when it cascades
+        unsigned slot = (timers[timer].due >> (BITS*level)) & (SLOTS - 1);
+        timers[timer].next = NONE;
+        if (heads[level][slot] == NONE)
+            heads[level][slot] = timer;
+        else
+            timers[tails[level][slot]].next = timer;
+        tails[level][slot] = timer;
+    }
+    unsigned short detach(unsigned level, unsigned slot) { // detach - empty the slot, returning its list
+        unsigned short head = heads[level][slot];
+        heads[level][slot] = tails[level][slot] = NONE;
+        return head;
+    }
+
+public:
+    void clear(unsigned int now_=0) { // clear - no timers, the time starts from now_ [call it before using the wheel]
+        for (unsigned level = 0; level < LEVELS; level++)
+            for (unsigned slot = 0; slot < SLOTS; slot++)
+                heads[level][slot] = tails[level][slot] = NONE;
+        for (unsigned short i = 0; i < CAPACITY; i++)
+            timers[i].next = i + 1 < CAPACITY ? i + 1 : NONE;
+        free = 0;
+        used = 0;
+        now = now_;
+    }
+
+    // schedule - the event fires delay ticks from now (at least 1), returns the timer or NONE if the wheel is full
+    unsigned short schedule(unsigned int delay, const Event& event) {
+        if (free == NONE)
+            return NONE;
+        unsigned short timer = free;
+        free = timers[timer].next;
+        used++;
+        timers[timer].event = event;
+        timers[timer].cancelled = false;
+        timers[timer].due = now + (delay == 0 ? 1 : delay);
+        insert(timer);
+        return timer;
+    }
+    // reschedule - a timer which was returned by advance() fires again delay ticks from now
+    void reschedule(unsigned short timer, unsigned int delay) {
+        timers[timer].due = now + (delay == 0 ? 1 : delay);
+        insert(timer);
+    }
+    // release - a timer which was returned by advance() is done
+    void release(unsigned short timer) {
+        timers[timer].next = free;
+        free = timer;
+        used--;
+    }
+    void cancel(unsigned short timer) { // cancel - the timer won't be returned by advance(), it's released when due
+        timers[timer].cancelled = true;
+    }
+
+    // advance - go to the next tick, returns the list of the timers due (see next()), in the order they were scheduled
+    // Each of them must then be either rescheduled or released
+    unsigned short advance() {
+        now++;
+        for (unsigned level = LEVELS - 1; level > 0; level--) { // The timers of the upper wheels move down when their slot comes
+            if ((now & ((1u << (BITS*level)) - 1)) != 0)
+                continue;
+            unsigned short timer = detach(level, (now >> (BITS*level)) & (SLOTS - 1));
+            while (timer != NONE) {
+                unsigned short next_ = timers[timer].next;
+                insert(timer);
+                timer = next_;
+            }
+        }
+        unsigned short head = NONE, tail = NONE;
+        unsigned short timer = detach(0, now & (SLOTS - 1));
+        while (timer != NONE) {
+            unsigned short next_ = timers[timer].next;
+            if (timers[timer].cancelled) {
+                release(timer);
+            } else {
+                timers[timer].next = NONE;
+                if (head == NONE)
+                    head = timer;
+                else
+                    timers[tail].next = timer;
+                tail = timer;
+            }
+            timer = next_;
+        }
+        return head;
+    }
+    unsigned short next(unsigned short timer) const { // next - the timer after this one in the list returned by advance()
+        return timers[timer].next;
+    }
+
+    Event& get(unsigned short timer) {
+        return timers[timer].event;
+    }
+    const Event& get(unsigned short timer) const {
+        return timers[timer].event;
+    }
+    unsigned int getDue(unsigned short timer) const {
+        return timers[timer].due;
+    }
+    unsigned int getNow() const {
+        return now;
+    }
+    bool isFull() const {
+        return free == NONE;
+    }
+    unsigned short getUsed() const { // getUsed - number of timers scheduled (the cancelled ones too, until they're due)
+        return used;
+    }
+
+    // forEach - call f(timer, event) for each timer scheduled and not cancelled, in no particular order across the slots
+    template <typename F>
+    void forEach(F f) const {
+        for (unsigned level = 0; level < LEVELS; level++)
+            for (unsigned slot = 0; slot < SLOTS; slot++)
+                for (unsigned short timer = heads[level][slot]; timer != NONE; timer = timers[timer].next)
+                    if (!timers[timer].cancelled)
+                        f(timer, timers[timer].event);
+    }
+    // isConsistent - every timer is in exactly one list and valid(event) for the scheduled ones, e.g. after reading the wheel from a file
+    template <typename F>
+    bool isConsistent(F valid) const {
+        bool seen[CAPACITY] = {};
+        unsigned short count = 0;
+        auto walk = [&](unsigned short timer, bool scheduled) {
+            for (; timer != NONE; timer = timers[timer].next) {
+                if (timer >= CAPACITY || seen[timer] || (scheduled && !valid(timers[timer].event)))
+                    return false;
+                seen[timer] = true;
+                count++;
+            }
+            return true;
+        };
+        for (unsigned level = 0; level < LEVELS; level++)
+            for (unsigned slot = 0; slot < SLOTS; slot++)
+                if (!walk(heads[level][slot], true))
+                    return false;
+        if (count != used || !walk(free, false))
+            return false;
+        return count == CAPACITY;
+    }
+};
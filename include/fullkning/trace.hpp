@@ -0,0 +1,144 @@
+#pragma once
+
+#ifdef FULLKNING_TRACE
+    #include <cstdint> // std::uint64_t
+    #include <atomic> // std::atomic
+    #include <chrono> // std::chrono::steady_clock
+    #include <memory> // std::unique_ptr
+    #include <mutex> // std::mutex, std::lock_guard
+    #include <string> // std::string
+    #include <vector> // std::vector
+    #include <fstream> // std::ofstream
+    #include <stdexcept> // std::runtime_error
+#endif
+
+#ifndef TRACE_EVENTS
+    #define TRACE_EVENTS 65536 // Events kept for each thread, the oldest ones are overwritten
+#endif
+
+
+// Timeline of the game in the Chrome trace-event format (chrome://tracing, ui.perfetto.dev)
+// Compile with FULLKNING_TRACE to record it, otherwise all of this is empty and compiles to nothing
+namespace trace {
+    #ifdef FULLKNING_TRACE
+        typedef std::chrono::steady_clock::time_point Time;
+
+        struct Event { // Event - a span (begin and duration) or an instant
+            const char* name; // name - a string literal, only the pointer is kept
+            std::uint64_t begin, duration; // begin, duration - nanoseconds since the trace started, duration is 0 for an instant
+            int argument; // argument - the cell the event is about, -1 if none
+            bool instant;
+        };
+
+        // Ring - the last TRACE_EVENTS events of a thread, written only by that thread
+        // When a thread ends its ring is taken by the next new thread, so short-lived threads (e.g. the key readers) share a row of the timeline
+        struct Ring {
+            std::vector<Event> events = std::vector<Event>(TRACE_EVENTS);
+            std::atomic<std::uint64_t> written{0}; // written - events recorded since the beginning, the newest is at (written - 1) % TRACE_EVENTS
+            std::string name; // name - what the thread is, as shown in the timeline
+            bool owned = true; // owned - a running thread records into the ring [guarded by mutex]
+        };
+
+        const Time beginning = std::chrono::steady_clock::now(); // beginning - when the trace started
+        std::vector<std::unique_ptr<Ring>> rings; // rings - one per thread, kept after it ends so it can be dumped [guarded by mutex]
+        std::mutex mutex;
+
+        struct Owner { // Owner - the ring of the current thread, given back when it ends
+            Ring* ring = nullptr;
+            ~Owner() {
+                if (ring == nullptr)
+                    return;
+                std::lock_guard<std::mutex> lock(mutex);
+                ring->owned = false;
+            }
+        };
+        Ring& ring() { // ring - the ring of the current thread, taken on the first event
+            thread_local Owner owner;
+            if (owner.ring != nullptr)
+                return *owner.ring;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::unique_ptr<Ring>& ring_ : rings)
+                if (!ring_->owned) {
+                    ring_->owned = true;
+                    return *(owner.ring = ring_.get());
+                }
+            rings.emplace_back(new Ring());
+            rings.back()->name = "thread " + std::to_string(rings.size());
+            return *(owner.ring = rings.back().get());
+        }
+        void record(const Event& event) {
+            Ring& ring_ = ring();
+            std::uint64_t written = ring_.written.load(std::memory_order_relaxed);
+            ring_.events[written % TRACE_EVENTS] = event;
+            ring_.written.store(written + 1, std::memory_order_release);
+        }
+        std::uint64_t since(Time time) { // since - nanoseconds from the beginning of the trace
+            return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time - beginning).count();
+        }
+
+        // name - the name of the current thread in the timeline, e.g. "render"
+        void name(const char* name_) {
+            Ring& ring_ = ring();
+            std::lock_guard<std::mutex> lock(mutex);
+            ring_.name = name_;
+        }
+        // span - record a span of the current thread which began and ended at these times
+        void span(const char* name_, Time begin, Time end) {
+            record(Event{name_, since(begin), since(end) - since(begin), -1, false});
+        }
+        // instant - record an instant event of the current thread, e.g. "unhook", about the cell (y*WIDTH + x) if it's not -1
+        void instant(const char* name_, int cell=-1) {
+            record(Event{name_, since(std::chrono::steady_clock::now()), 0, cell, true});
+        }
+
+        // Span - records its own lifetime as a span of the current thread
+        class Span {
+        private:
+            const char* name;
+            Time begin;
+
+        public:
+            Span(const char* name_): name(name_), begin(std::chrono::steady_clock::now()) {}
+            ~Span() {
+                span(name, begin, std::chrono::steady_clock::now());
+            }
+        };
+
+        // dump - write all the events kept in the trace-event JSON format, throws std::runtime_error if it can't
+        // ⚠️ The threads should be done recording, the event being written by a running one could be torn
+        void dump(const std::string& path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::string output = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+            bool first = true;
+            for (std::size_t tid = 0; tid < rings.size(); tid++) {
+                const Ring& ring_ = *rings[tid];
+                output += first ? "" : ",\n";
+                first = false;
+                output += "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + std::to_string(tid + 1) + ", \"args\": {\"name\": \"" + ring_.name + "\"}}";
+                std::uint64_t written = ring_.written.load(std::memory_order_acquire);
+                for (std::uint64_t i = written > TRACE_EVENTS ? written - TRACE_EVENTS : 0; i < written; i++) {
+                    const Event& event = ring_.events[i % TRACE_EVENTS];
+                    output += ",\n{\"name\": \"" + std::string(event.name) + "\", \"ph\": \"" + (event.instant ? "i\", \"s\": \"t" : "X");
+                    output += "\", \"pid\": 1, \"tid\": " + std::to_string(tid + 1);
+                    output += ", \"ts\": " + std::to_string(event.begin / 1000) + "." + std::to_string(1000 + event.begin % 1000).substr(1); // Microseconds
+                    if (!event.instant)
+                        output += ", \"dur\": " + std::to_string(event.duration / 1000) + "." + std::to_string(1000 + event.duration % 1000).substr(1);
+                    if (event.argument >= 0)
+                        output += ", \"args\": {\"cell\": " + std::to_string(event.argument) + "}";
+                    output += "}";
+                }
+            }
+            output += "\n]}\n";
+            std::ofstream file(path, std::ios::trunc);
+            if (!file.write(output.data(), output.size()))
+                throw std::runtime_error("the file can't be written");
+        }
+    #else
+        class Span {
+        public:
+            Span(const char*) {}
+        };
+        void name(const char*) {}
+        void instant(const char*, int=-1) {}
+    #endif
+};
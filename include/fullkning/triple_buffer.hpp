@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic> // std::atomic
+
+
+// TripleBuffer - lock-free handoff of the newest value from one producer thread to one consumer thread
+// The producer never waits for the consumer, values which were not consumed in time are overwritten
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr unsigned char FRESH = 4; // FRESH - the middle slot holds a value the consumer has not seen
+    static constexpr unsigned char INDEX = 3; // INDEX - mask of the slot index
+
+    T slots[3];
+    unsigned char back = 0; // back - slot being written by the producer
+    unsigned char front = 1; // front - slot being read by the consumer
+    alignas(64) std::atomic<unsigned char> middle{2}; // middle - slot being exchanged, with the FRESH bit
+
+public:
+    T& getBack() { // getBack - the slot to fill before publish() [producer]
+        return slots[back];
+    }
+    // publish - make the back slot the newest value [producer]
+    // Returns false if the previous value was never consumed, so it has been dropped
+    bool publish() {
+        unsigned char previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+        return !(previous & FRESH);
+    }
+
+    // update - take the newest value, if there's one the consumer has not seen [consumer]
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& getFront() const { // getFront - the value taken by the last update() [consumer]
+        return slots[front];
+    }
+};
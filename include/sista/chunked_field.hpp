@@ -0,0 +1,310 @@
+#pragma once
+
+#include <array> // std::array
+#include <cstdint> // std::uint64_t
+#include <vector> // std::vector
+#include <memory> // std::unique_ptr
+#include <unordered_map> // std::unordered_map
+#include <algorithm> // std::sort
+#include <stdexcept> // std::out_of_range, std::invalid_argument
+#include "pawn.hpp" // Pawn
+#include "cursor.hpp" // Cursor
+#include "viewport.hpp" // Viewport
+
+#ifndef CHUNK_SIZE
+    #define CHUNK_SIZE 64 // Side of the square chunks of a ChunkedField
+#endif
+
+namespace sista {
+    // ChunkedField class - a field stored as CHUNK_SIZE*CHUNK_SIZE chunks, only the chunks with pawns exist
+    // The memory depends on the occupied area and not on the size of the field, which can be up to 65536*65536
+    class ChunkedField {
+    protected:
+        static_assert(CHUNK_SIZE*CHUNK_SIZE % 64 == 0, "The cells of a chunk must fill whole 64-bit words");
+        static_assert(CHUNK_SIZE*CHUNK_SIZE <= 65535, "The pawns of a chunk are counted in an unsigned short");
+        struct Chunk { // Chunk - a square of cells of the field
+            std::array<Pawn*, CHUNK_SIZE*CHUNK_SIZE> cells; // cells[y*CHUNK_SIZE + x] - relative to the top-left corner of the chunk
+            std::array<std::uint64_t, CHUNK_SIZE*CHUNK_SIZE/64> occupied; // occupied - bit i is set if cells[i] has a pawn
+            unsigned short count = 0; // count - number of pawns in the chunk, it's freed when it reaches 0
+
+            Chunk() {
+                cells.fill(nullptr);
+                occupied.fill(0);
+            }
+            void set(std::size_t index, Pawn* pawn) { // set - put the pawn (or nullptr) in cells[index], keeping count and occupied
+                std::uint64_t mask = (std::uint64_t)1 << (index % 64);
+                if (cells[index] == nullptr && pawn != nullptr) {
+                    occupied[index / 64] |= mask;
+                    count++;
+                } else if (cells[index] != nullptr && pawn == nullptr) {
+                    occupied[index / 64] &= ~mask;
+                    count--;
+                }
+                cells[index] = pawn;
+            }
+            static unsigned lowest(std::uint64_t word) { // lowest - index of the lowest set bit of a word which isn't 0
+                #if defined(__GNUC__) || defined(__clang__)
+                    return (unsigned)__builtin_ctzll(word);
+                #else
+                    unsigned index = 0;
+                    for (; !(word & 1); word >>= 1)
+                        index++;
+                    return index;
+                #endif
+            }
+            template <typename Function>
+            void forEach(Function function) { // forEach - call function(pawn) for each pawn, the empty words are skipped
+                for (std::size_t i = 0; i < occupied.size(); i++) {
+                    std::uint64_t word = occupied[i];
+                    while (word) {
+                        function(cells[i*64 + lowest(word)]);
+                        word &= word - 1; // Clear the lowest set bit
+                    }
+                }
+            }
+        };
+
+        std::unordered_map<Coordinates, std::unique_ptr<Chunk>> chunks; // chunks[coordinates / CHUNK_SIZE] - the chunks with pawns
+        Cursor cursor; // Cursor
+        int width; // Width of the field
+        int height; // Height of the field
+        std::size_t pawnsCount = 0; // Number of pawns in the field
+        Viewport* viewport = nullptr; // Visible window of the field (nullptr - the whole field is visible)
+        bool drawing = true; // If the changes to the field are drawn as they happen
+
+        static Coordinates chunkOf(const Coordinates& coordinates) { // chunkOf - coordinates of the chunk containing the cell
+            return Coordinates(coordinates.y / CHUNK_SIZE, coordinates.x / CHUNK_SIZE);
+        }
+        static std::size_t cellOf(const Coordinates& coordinates) { // cellOf - index of the cell in its chunk
+            return (std::size_t)(coordinates.y % CHUNK_SIZE) * CHUNK_SIZE + coordinates.x % CHUNK_SIZE;
+        }
+        // page - called with the coordinates of a chunk which is not in chunks, before it's considered empty
+        // A subclass can put the chunk in chunks from somewhere else (see StreamedField)
+        virtual void page(const Coordinates&) {}
+        Chunk* findChunk(const Coordinates& coordinates) { // findChunk - the chunk containing the cell, nullptr if it's empty
+            std::unordered_map<Coordinates, std::unique_ptr<Chunk>>::iterator it = chunks.find(chunkOf(coordinates));
+            if (it == chunks.end()) {
+                page(chunkOf(coordinates));
+                it = chunks.find(chunkOf(coordinates));
+            }
+            return it == chunks.end() ? nullptr : it->second.get();
+        }
+
+        void removeAt(const Coordinates& coordinates) { // removeAt - empty the cell, freeing its chunk if it's left empty
+            Chunk* chunk = findChunk(coordinates);
+            if (chunk == nullptr)
+                return;
+            std::size_t cell = cellOf(coordinates);
+            if (chunk->cells[cell] == nullptr)
+                return;
+            chunk->set(cell, nullptr);
+            pawnsCount--;
+            if (chunk->count == 0)
+                chunks.erase(chunkOf(coordinates));
+        }
+
+        bool placeCursor(Coordinates coordinates) { // Set the cursor to the cell, false if the cell is not visible
+            if (!drawing) // Someone else is printing the field
+                return false;
+            if (viewport == nullptr) {
+                cursor.set(coordinates);
+                return true;
+            }
+            if (!viewport->contains(coordinates))
+                return false;
+            cursor.set(viewport->toScreen(coordinates));
+            return true;
+        }
+
+    public:
+        ChunkedField(int width_, int height_): width(width_), height(height_) {} // Constructor, nothing is allocated
+        virtual ~ChunkedField() {
+            reset();
+        }
+
+        void clear() { // Clear the field, without deleting the pawns
+            chunks.clear();
+            pawnsCount = 0;
+        }
+        void reset() { // Clear the field and delete the pawns
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks)
+                chunk.second->forEach([](Pawn* pawn) {
+                    delete pawn;
+                });
+            clear();
+        }
+
+        void setViewport(Viewport* viewport_) { // Only the cells in the viewport will be printed (nullptr - all of them)
+            viewport = viewport_;
+        }
+        Viewport* getViewport() {
+            return viewport;
+        }
+        void setDrawing(bool drawing_) { // false - the field is updated without printing anything (print() still prints)
+            drawing = drawing_;
+        }
+
+        void print(char border) { // Prints the visible part of the field with custom border
+            int firstRow = 0, lastRow = height, firstColumn = 0, lastColumn = width;
+            if (viewport != nullptr) {
+                firstRow = viewport->getTop(), lastRow = firstRow + viewport->getRows();
+                firstColumn = viewport->getLeft(), lastColumn = firstColumn + viewport->getColumns();
+            }
+            ANSI::reset(); // Reset the settings
+            std::cout << '\n';
+            for (int i = firstColumn; i < lastColumn + 2; i++)
+                std::cout << border;
+            std::cout << '\n';
+            for (int y = firstRow; y < lastRow; y++) {
+                std::cout << border;
+                for (int x = firstColumn; x < lastColumn; x++) {
+                    Chunk* chunk = findChunk(Coordinates(y, x));
+                    if (chunk == nullptr) { // The rest of the chunk's row is empty
+                        int end = std::min(lastColumn, (x / CHUNK_SIZE + 1) * CHUNK_SIZE);
+                        std::cout << std::string(end - x, ' ');
+                        x = end - 1;
+                        continue;
+                    }
+                    Pawn* pawn = chunk->cells[cellOf(Coordinates(y, x))];
+                    if (pawn != nullptr) {
+                        pawn->print();
+                        ANSI::reset();
+                    } else {
+                        std::cout << ' ';
+                    }
+                }
+                std::cout << border << '\n';
+            }
+            for (int i = firstColumn; i < lastColumn + 2; i++)
+                std::cout << border;
+            std::cout << std::flush;
+        }
+
+        void addPawn(Pawn* pawn) { // Add a pawn to the field, allocating its chunk if needed
+            findChunk(pawn->getCoordinates()); // The chunk could be somewhere else
+            std::unique_ptr<Chunk>& chunk = chunks[chunkOf(pawn->getCoordinates())];
+            if (chunk == nullptr)
+                chunk.reset(new Chunk());
+            std::size_t cell = cellOf(pawn->getCoordinates());
+            if (chunk->cells[cell] == nullptr)
+                pawnsCount++;
+            chunk->set(cell, pawn);
+        }
+        void removePawn(Pawn* pawn) { // Remove a pawn from the field, freeing its chunk if it's left empty
+            removeAt(pawn->getCoordinates());
+        }
+        void addPrintPawn(Pawn* pawn) { // Add a pawn to the field and print it
+            addPawn(pawn);
+            if (placeCursor(pawn->getCoordinates()))
+                pawn->print();
+        }
+
+        void movePawn(Pawn* pawn, Coordinates& coordinates) { // Move a pawn to the coordinates
+            if (pawn->getCoordinates() == coordinates)
+                return;
+            validateCoordinates(coordinates);
+            if (placeCursor(pawn->getCoordinates())) { // Clear the old cell
+                ANSI::reset();
+                std::cout << ' ';
+            }
+            if (placeCursor(coordinates))
+                pawn->print();
+            Coordinates previous = pawn->getCoordinates();
+            pawn->setCoordinates(coordinates);
+            addPawn(pawn); // Added before removing it, so a chunk is not freed and allocated again when the pawn stays in it
+            removeAt(previous);
+        }
+        void movePawn(Pawn* pawn, unsigned short y, unsigned short x) {
+            Coordinates coordinates(y, x);
+            movePawn(pawn, coordinates);
+        }
+        // ⚠️ This throws an exception if the pawn would leave the field (or land on another pawn)
+        void movePawnBy(Pawn* pawn, short int y, short int x) {
+            int y_ = pawn->getCoordinates().y + y;
+            int x_ = pawn->getCoordinates().x + x;
+            if (isOutOfBounds(y_, x_)) // Checked before narrowing, -1 would wrap to 65535
+                throw std::invalid_argument("The movement leaves the field");
+            movePawn(pawn, (unsigned short)y_, (unsigned short)x_);
+        }
+
+        // fall - move every pawn for which falls(pawn) is true one cell down, if the cell below is free
+        // The pawns are moved from the bottom up, so a column of falling pawns moves all together
+        // Only the occupied cells of the chunks with pawns are visited, returns the number of pawns moved
+        template <typename Predicate>
+        std::size_t fall(Predicate falls) {
+            std::vector<Pawn*> falling;
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks)
+                chunk.second->forEach([&](Pawn* pawn) {
+                    if (falls(pawn))
+                        falling.push_back(pawn);
+                });
+            if (falling.empty())
+                return 0;
+            std::sort(falling.begin(), falling.end(), [](Pawn* first, Pawn* second) {
+                return second->getCoordinates() < first->getCoordinates(); // Bottom rows first
+            });
+            std::size_t moved = 0;
+            for (Pawn* pawn : falling) {
+                if (isFree((int)pawn->getCoordinates().y + 1, (int)pawn->getCoordinates().x)) {
+                    movePawnBy(pawn, 1, 0);
+                    moved++;
+                }
+            }
+            return moved;
+        }
+        template <typename Function>
+        void forEach(Function function) { // forEach - call function(pawn) for each pawn, chunk by chunk
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks)
+                chunk.second->forEach(function);
+        }
+
+        Pawn* getPawn(Coordinates& coordinates) { // Get the pawn at the coordinates
+            Chunk* chunk = findChunk(coordinates);
+            return chunk == nullptr ? nullptr : chunk->cells[cellOf(coordinates)];
+        }
+        Pawn* getPawn(unsigned short y, unsigned short x) {
+            Coordinates coordinates(y, x);
+            return getPawn(coordinates);
+        }
+
+        bool isOccupied(Coordinates& coordinates) { // Check if the coordinates are occupied
+            return (getPawn(coordinates) != nullptr);
+        }
+        bool isOccupied(unsigned short y, unsigned short x) {
+            return (getPawn(y, x) != nullptr);
+        }
+        bool isOutOfBounds(Coordinates& coordinates) { // Check if the coordinates are out of bounds
+            return (coordinates.y >= height || coordinates.x >= width);
+        }
+        bool isOutOfBounds(int y, int x) {
+            return (y < 0 || y >= height || x < 0 || x >= width);
+        }
+        bool isFree(Coordinates& coordinates) { // Check if the coordinates are occupied or out of bounds
+            return !(isOutOfBounds(coordinates) || isOccupied(coordinates));
+        }
+        bool isFree(int y, int x) {
+            return !(isOutOfBounds(y, x) || isOccupied((unsigned short)y, (unsigned short)x));
+        }
+
+        // ⚠️ This throws an exception if the coordinates are invalid
+        void validateCoordinates(Coordinates& coordinates) { // Validate the coordinates
+            if (isOutOfBounds(coordinates))
+                throw std::out_of_range("Coordinates are out of bounds");
+            if (isOccupied(coordinates))
+                throw std::invalid_argument("Coordinates are occupied");
+        }
+
+        int getWidth() {
+            return width;
+        }
+        int getHeight() {
+            return height;
+        }
+        std::size_t getPawnsCount() { // Number of pawns in the field
+            return pawnsCount;
+        }
+        std::size_t getChunksCount() { // Number of allocated chunks, the memory used is about getChunksCount()*sizeof(Chunk)
+            return chunks.size();
+        }
+    };
+};
@@ -1,27 +1,82 @@
 #pragma once
 
 #include <utility> // std::pair, std::swap
+#include <cstddef> // std::size_t
+#include <functional> // std::hash
 
 namespace sista {
     typedef std::pair<unsigned short, unsigned short> Coord; // Coordinates made into a pair [y, x]
 
 
-    struct Coordinates { // 2D coordinates
+    struct Coordinates { // 2D coordinates, packed in 32 bits
         unsigned short y; // y coordinate
         unsigned short x; // x coordinate
 
-        Coordinates(): y(0), x(0) {} // Constructor
-        Coordinates(unsigned short y_, unsigned short x_): y(y_), x(x_) {} // Constructor
-        Coordinates(Coord coord): y(coord.first), x(coord.second) {} // Constructor
+        constexpr Coordinates(): y(0), x(0) {} // Constructor
+        constexpr Coordinates(unsigned short y_, unsigned short x_): y(y_), x(x_) {} // Constructor
+        constexpr Coordinates(Coord coord): y(coord.first), x(coord.second) {} // Constructor
 
-        bool operator==(const Coordinates& other) const {
+        constexpr bool operator==(const Coordinates& other) const {
             return (y == other.y && x == other.x);
         }
-        bool operator!=(const Coordinates& other) const {
+        constexpr bool operator!=(const Coordinates& other) const {
             return (y != other.y || x != other.x);
         }
-        Coordinates operator+(const Coordinates& other) const {
+        constexpr bool operator<(const Coordinates& other) const { // Row-major order, the same as toIndex()
+            return pack() < other.pack();
+        }
+        constexpr Coordinates operator+(const Coordinates& other) const {
             return Coordinates(y + other.y, x + other.x);
         }
+
+        // pack - the coordinates as a single 32-bit value [y][x], unpack() is the inverse
+        constexpr unsigned int pack() const {
+            return ((unsigned int)y << 16) | x;
+        }
+        static constexpr Coordinates unpack(unsigned int packed) {
+            return Coordinates((unsigned short)(packed >> 16), (unsigned short)(packed & 0xFFFF));
+        }
+        // toIndex - position of the cell in a row-major array with rows of width cells, fromIndex() is the inverse
+        constexpr std::size_t toIndex(int width) const {
+            return (std::size_t)y * width + x;
+        }
+        static constexpr Coordinates fromIndex(std::size_t index, int width) {
+            return Coordinates((unsigned short)(index / width), (unsigned short)(index % width));
+        }
+
+        // Adding an offset to coordinates in a width*height field, for when the sum falls out of it
+        // wrapped - each coordinate wraps around on its own [PACMAN_EFFECT]
+        constexpr Coordinates wrapped(short int y_, short int x_, int width, int height) const {
+            return Coordinates((unsigned short)modulo(y + y_, height), (unsigned short)modulo(x + x_, width));
+        }
+        // carried - the column overflows into the next or previous rows [MATRIX_EFFECT]
+        // The result can still be out of the field (y >= height), it has to be checked by the caller
+        constexpr Coordinates carried(short int y_, short int x_, int width) const {
+            return Coordinates((unsigned short)(y + y_ + floorDivision(x + x_, width)), (unsigned short)modulo(x + x_, width));
+        }
+        // saturated - each coordinate stops on the edge of the field
+        constexpr Coordinates saturated(short int y_, short int x_, int width, int height) const {
+            return Coordinates((unsigned short)clamp(y + y_, height), (unsigned short)clamp(x + x_, width));
+        }
+
+    private:
+        static constexpr int modulo(int value, int size) { // The result is always in [0, size)
+            return ((value % size) + size) % size;
+        }
+        static constexpr int floorDivision(int value, int size) { // Rounds towards -infinity, unlike '/'
+            return (value - modulo(value, size)) / size;
+        }
+        static constexpr int clamp(int value, int size) {
+            return value < 0 ? 0 : (value >= size ? size - 1 : value);
+        }
     }; // field[y][x] - y is the row, x is the column
-};
\ No newline at end of file
+};
+
+namespace std {
+    template <>
+    struct hash<sista::Coordinates> { // Coordinates can be used as keys of std::unordered_map and std::unordered_set
+        std::size_t operator()(const sista::Coordinates& coordinates) const noexcept {
+            return coordinates.pack(); // Different coordinates always have different packs
+        }
+    };
+};
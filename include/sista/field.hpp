@@ -3,12 +3,20 @@
 #include <vector> // std::vector
 #include <queue> // std::queue, std::priority_queue
 #include <algorithm> // std::sort
+#include <unordered_map> // std::unordered_map
+#include <thread> // std::thread
+#include <mutex> // std::mutex, std::unique_lock
+#include <condition_variable> // std::condition_variable
 #include "pawn.hpp" // Pawn
 #include "border.hpp" // Border
 #include "cursor.hpp" // Cursor
+#include "viewport.hpp" // Viewport
 
 #define PACMAN_EFFECT 0 // Pacman effect when a coordinate overflows
 #define MATRIX_EFFECT 1 // Classic C style matrix effect when a coordinate overflows
+#ifndef PARALLEL_SWAPS
+    #define PARALLEL_SWAPS 4096 // Number of swaps from which SwappableField::applySwaps() uses all the cores
+#endif
 
 namespace sista {
     class Field { // Field class - represents the field [parent class]
@@ -17,6 +25,31 @@ namespace sista {
         Cursor cursor; // Cursor
         int width; // Width of the matrix
         int height; // Height of the matrix
+        Viewport* viewport = nullptr; // Visible window of the matrix (nullptr - the whole matrix is visible)
+        bool drawing = true; // If the changes to the matrix are drawn as they happen
+
+        bool placeCursor(Coordinates coordinates) { // Set the cursor to the cell, false if the cell is not visible
+            if (!drawing) // Someone else is printing the matrix
+                return false;
+            if (viewport == nullptr) {
+                cursor.set(coordinates);
+                return true;
+            }
+            if (!viewport->contains(coordinates)) // Drawing out of the viewport would scroll the terminal...
+                return false; // ...so the draw is dropped
+            cursor.set(viewport->toScreen(coordinates));
+            return true;
+        }
+        // Visible rows [firstRow, lastRow) and columns [firstColumn, lastColumn)
+        void visibleRange(int& firstRow, int& lastRow, int& firstColumn, int& lastColumn) {
+            if (viewport == nullptr) {
+                firstRow = 0, lastRow = height;
+                firstColumn = 0, lastColumn = width;
+                return;
+            }
+            firstRow = viewport->getTop(), lastRow = firstRow + viewport->getRows();
+            firstColumn = viewport->getLeft(), lastColumn = firstColumn + viewport->getColumns();
+        }
 
     public:
         void clear() { // Clear the matrix
@@ -47,11 +80,24 @@ namespace sista {
             pawns.clear(); // Clear the pawns
         }
 
+        void setViewport(Viewport* viewport_) { // Only the cells in the viewport will be printed (nullptr - all of them)
+            viewport = viewport_;
+        }
+        Viewport* getViewport() {
+            return viewport;
+        }
+        void setDrawing(bool drawing_) { // false - the matrix is updated without printing anything (print() still prints)
+            drawing = drawing_;
+        }
+
         void print() { // Print the matrix
+            int firstRow, lastRow, firstColumn, lastColumn;
+            visibleRange(firstRow, lastRow, firstColumn, lastColumn);
             ANSI::reset(); // Reset the settings
             bool previousPawn = false; // If the previous element was a Pawn
-            for (auto& row: pawns) { // For each row
-                for (auto& pawn: row) { // For each pawn
+            for (int y = firstRow; y < lastRow; y++) { // For each row
+                for (int x = firstColumn; x < lastColumn; x++) { // For each pawn
+                    Pawn* pawn = pawns[y][x];
                     if (pawn != nullptr) { // If the pawn is not nullptr
                         pawn->print(); // Print the pawn
                         previousPawn = true; // Set the previousPawn to true
@@ -69,15 +115,18 @@ namespace sista {
             std::cout << std::flush; // Flush the output
         }
         void print(char border) { // Prints with custom border
+            int firstRow, lastRow, firstColumn, lastColumn;
+            visibleRange(firstRow, lastRow, firstColumn, lastColumn);
             ANSI::reset(); // Reset the settings
             std::cout << '\n';
-            for (int i=0; i<width+2; i++) // For each row
+            for (int i=firstColumn; i<lastColumn+2; i++) // For each row
                 std::cout << border; // Print the border
             std::cout << '\n';
             bool previousPawn = false; // If the previous element was a Pawn
-            for (auto& row: pawns) { // For each row
+            for (int y = firstRow; y < lastRow; y++) { // For each row
                 std::cout << border; // Print the border
-                for (auto& pawn: row) { // For each pawn
+                for (int x = firstColumn; x < lastColumn; x++) { // For each pawn
+                    Pawn* pawn = pawns[y][x];
                     if (pawn != nullptr) { // If the pawn is not nullptr
                         pawn->print(); // Print the pawn
                         previousPawn = true; // Set the previousPawn to true
@@ -92,22 +141,25 @@ namespace sista {
                 ANSI::reset(); // Reset the settings
                 std::cout << border << '\n'; // Print the border and a new line
             }
-            for (int i=0; i<width+2; i++) // For each row
+            for (int i=firstColumn; i<lastColumn+2; i++) // For each row
                 std::cout << border; // Print the border
             std::cout << std::flush; // Flush the output
         }
         void print(Border& border) { // Prints with custom border
+            int firstRow, lastRow, firstColumn, lastColumn;
+            visibleRange(firstRow, lastRow, firstColumn, lastColumn);
             ANSI::reset(); // Reset the settings
             std::cout << '\n';
             border.print(); // Print the border
-            for (int i=0; i<width+1; i++) // For each row
+            for (int i=firstColumn; i<lastColumn+1; i++) // For each row
                 border.print(false); // Print the border
             ANSI::reset(); // Reset the settings
             std::cout << '\n';
             bool previousPawn = true; // If the previous element was a Pawn
-            for (auto& row: pawns) { // For each row
+            for (int y = firstRow; y < lastRow; y++) { // For each row
                 border.print(); // Print the border
-                for (auto& pawn: row) { // For each pawn
+                for (int x = firstColumn; x < lastColumn; x++) { // For each pawn
+                    Pawn* pawn = pawns[y][x];
                     if (pawn != nullptr) { // If the pawn is not nullptr
                         pawn->print(); // Print the pawn
                         previousPawn = true; // Set the previousPawn to true
@@ -125,7 +177,7 @@ namespace sista {
                 std::cout << '\n';
             }
             border.print(); // Print the border
-            for (int i=0; i<width+1; i++) // For each row
+            for (int i=firstColumn; i<lastColumn+1; i++) // For each row
                 border.print(false); // Print the border
             ANSI::reset(); // Reset the settings
             std::cout << std::flush; // Flush the output
@@ -140,8 +192,8 @@ namespace sista {
 
         void addPrintPawn(Pawn* pawn) { // Add a pawn to the matrix and print it
             addPawn(pawn); // Add the pawn to the matrix
-            this->cursor.set(pawn->getCoordinates()); // Set the cursor to the pawn's coordinates
-            pawn->print(); // Print the pawn
+            if (placeCursor(pawn->getCoordinates())) // Set the cursor to the pawn's coordinates
+                pawn->print(); // Print the pawn
         }
 
         void movePawn(Pawn* pawn, Coordinates& coordinates) { // Move a pawn to the coordinates
@@ -154,11 +206,12 @@ namespace sista {
                 throw std::invalid_argument("The coordinates are occupied by another pawn");
             }
             // Cursor ANSI stuff
-            cursor.set(pawn->getCoordinates()); // Set the cursor to the pawn's coordinates
-            ANSI::reset(); // Reset the settings for that cell
-            std::cout << ' '; // Print a space to clear the cell
-            cursor.set(coordinates); // Set the cursor to the coordinates
-            pawn->print(); // Print the pawn
+            if (placeCursor(pawn->getCoordinates())) { // Set the cursor to the pawn's coordinates
+                ANSI::reset(); // Reset the settings for that cell
+                std::cout << ' '; // Print a space to clear the cell
+            }
+            if (placeCursor(coordinates)) // Set the cursor to the coordinates
+                pawn->print(); // Print the pawn
 
             // sista::Field stuff
             removePawn(pawn); // Remove the pawn from the matrix
@@ -200,36 +253,18 @@ namespace sista {
             short int x_ = pawn->getCoordinates().x + x;
             if (!isOutOfBounds(y_, x_)) { // If the coordinates are not out of bounds...
                 movePawn(pawn, y_, x_); // ...no need to apply any effect
-            } else if (effect == PACMAN_EFFECT) { // If the effect is PACMAN_EFFECT...
+                return;
+            }
+            Coordinates coordinates;
+            if (effect == PACMAN_EFFECT) { // If the effect is PACMAN_EFFECT...
                 // ...well, you know how Pac Man works
-                if (x_ < 0) {
-                    x_ = width-1-(x_ % width);
-                    if (x_ == width)
-                        x_ = width - 1;
-                } else if (x_ >= width) {
-                    x_ %= width;
-                }
-                if (y_ < 0) {
-                    y_ = height-1-(y_ % width);
-                    if (y_ == height)
-                        y_ = height -1;
-                } else if (y_ >= height) {
-                    y_ %= height;
-                }
-            } else if (effect == MATRIX_EFFECT) {
-                short int y = y_;
-                short int x = x_;
-                if (x_ < 0) {
-                    x_ = width+(x_ % width);
-                    y_ = y + (short int)(x / width) - 1;
-                } else if (x_ >= width) {
-                    x_ %= width;
-                    y_ = y + (short int)(x / width);
-                }
-                // This [y_] could lead to a coordinate out of bounds...
-                validateCoordinates(y_, x_); // ...so we need to validate it
+                coordinates = pawn->getCoordinates().wrapped(y, x, width, height);
+            } else {
+                coordinates = pawn->getCoordinates().carried(y, x, width);
+                // This [y] could lead to a coordinate out of bounds...
+                validateCoordinates(coordinates); // ...so we need to validate it
             }
-            movePawn(pawn, y_, x_);
+            movePawn(pawn, coordinates);
         }
 
         void movePawnFromTo(Coordinates& coordinates, Coordinates& newCoordinates) {
@@ -342,20 +377,103 @@ namespace sista {
         std::vector<std::vector<short int>> pawnsCount; // pawnsCount[y][x] - number of pawns at pawns[y][x]
         // NOTE: short int instead of bool because of the possibility of having more than 2 pawns on the same field during swap trials
         std::vector<Path> pawnsToSwap; // pawnsToSwap - pawns that need to be swapped
-
-        Coord firstInvalidCell(std::vector<std::vector<short int>>& pawnsCount_) { // lowerBound - find the first cell with a value >= value
-            for (int y = 0; y < height; y++) {
-                for (int x = 0; x < width; x++) {
-                    if (pawnsCount_[y][x] >= 2) {
-                        return Coord(y, x);
-                    }
-                }
+        // NOTE: a removed path is left in pawnsToSwap with a nullptr pawn, so that the others don't shift, it's dropped by simulateSwaps
+        std::unordered_map<unsigned long long, std::vector<std::size_t>> pendingPaths; // pendingPaths[packPath(begin, end)] - indices of the pawnsToSwap going from begin to end
+
+        // The workers of applySwaps(), started by the first big one, the calling thread does the first group of rows and workers[k] the (k+1)-th
+        typedef void (*Phase)(std::vector<std::vector<Pawn*>>&, std::vector<Path*>&);
+        struct Arguments { // Arguments - those of the phase being done [mutex]
+            Phase phase;
+            std::vector<std::vector<Path*>>* groups; // groups[i] - paths of the i-th group of rows
+        };
+        unsigned threads; // threads - threads used by a big applySwaps()
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake; // wake - a phase was started, or the field is destroyed
+        std::condition_variable finished; // finished - the workers did their groups of the phase
+        Arguments arguments = {};
+        unsigned long long phases = 0; // phases - phases started [mutex]
+        unsigned pending = 0; // pending - workers which didn't finish their group of the phase yet [mutex]
+        bool stopping = false; // [mutex]
+
+        struct SwapCell { // SwapCell - a cell touched by the pending swaps
+            short int count; // count - number of pawns on the cell once the swaps are applied
+            std::vector<std::size_t> arriving; // arriving - indices of the paths ending on the cell, by priority
+            std::size_t cancelled = 0; // cancelled - how many of the arriving paths were cancelled
+        };
+        static void emptyBegins(std::vector<std::vector<Pawn*>>& pawns_, std::vector<Path*>& paths) { // emptyBegins - first phase of applySwaps
+            for (Path* path : paths)
+                pawns_[path->begin.y][path->begin.x] = nullptr;
+        }
+        static void fillEnds(std::vector<std::vector<Pawn*>>& pawns_, std::vector<Path*>& paths) { // fillEnds - second phase of applySwaps
+            for (Path* path : paths) {
+                pawns_[path->end.y][path->end.x] = path->pawn;
+                path->pawn->setCoordinates(path->end);
+            }
+        }
+        void work(std::size_t group) { // work - a worker, which does the group-th group of rows of each phase
+            unsigned long long done = 0; // done - phases done
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [&]() {
+                    return stopping || phases != done;
+                });
+                if (stopping)
+                    return;
+                done = phases;
+                Arguments phase_ = arguments;
+                lock.unlock();
+                phase_.phase(pawns, (*phase_.groups)[group]);
+                lock.lock();
+                if (--pending == 0)
+                    finished.notify_one();
+            }
+        }
+        void run(Phase phase, std::vector<std::vector<Path*>>& groups) { // run - a phase of applySwaps, on all the groups of rows
+            if (groups.size() == 1) {
+                phase(pawns, groups[0]);
+                return;
             }
-            throw std::runtime_error("No invalid cells found");
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                arguments = Arguments{phase, &groups};
+                pending = (unsigned)workers.size();
+                phases++;
+            }
+            wake.notify_all();
+            phase(pawns, groups[0]);
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this]() {
+                return pending == 0;
+            });
+        }
+        static unsigned long long packPath(const Coordinates& begin, const Coordinates& end) { // packPath - key of a path in pendingPaths
+            return ((unsigned long long)begin.pack() << 32) | end.pack();
+        }
+
+        std::size_t findPath(const Coordinates& begin, const Coordinates& end) { // findPath - first pending path from begin to end, pawnsToSwap.size() if none
+            std::unordered_map<unsigned long long, std::vector<std::size_t>>::iterator it = pendingPaths.find(packPath(begin, end));
+            return it == pendingPaths.end() ? pawnsToSwap.size() : it->second.front();
+        }
+        void pushPath(const Path& path) { // pushPath - add a path to the pawnsToSwap and to the index
+            pendingPaths[packPath(path.begin, path.end)].push_back(pawnsToSwap.size());
+            pawnsToSwap.push_back(path);
+        }
+        void removePath(std::size_t index) { // removePath - remove the first pending path with its begin and end, without shifting the others
+            std::unordered_map<unsigned long long, std::vector<std::size_t>>::iterator it = pendingPaths.find(packPath(pawnsToSwap[index].begin, pawnsToSwap[index].end));
+            it->second.erase(it->second.begin()); // index is the front, as findPath returned it
+            if (it->second.empty())
+                pendingPaths.erase(it);
+            pawnsToSwap[index].pawn = nullptr;
+        }
+        void indexPaths() { // indexPaths - build the pendingPaths again, after pawnsToSwap was sorted or compacted
+            pendingPaths.clear();
+            for (std::size_t i = 0; i < pawnsToSwap.size(); i++)
+                pendingPaths[packPath(pawnsToSwap[i].begin, pawnsToSwap[i].end)].push_back(i);
         }
 
     public:
-        SwappableField(int width, int height) : Field(width, height) {
+        SwappableField(int width, int height, unsigned threads_=std::thread::hardware_concurrency()) : Field(width, height), threads(std::max(1u, threads_)) {
             pawnsCount.resize(height);
             for (int y = 0; y < height; y++) {
                 pawnsCount[y].resize(width);
@@ -365,11 +483,20 @@ namespace sista {
             }
         }
         ~SwappableField() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers)
+                worker.join();
             for (int i = 0; i < (int)pawns.size(); i++) // For each row
                 for (int j = 0; j < (int)pawns[i].size(); j++) // For each pawn
                     delete pawns[i][j]; // Delete the pawn
             pawns.clear(); // Clear the pawns
         }
+        SwappableField(const SwappableField&) = delete;
+        SwappableField& operator=(const SwappableField&) = delete;
 
         void addPawn(Pawn* pawn) override { // addPawn - add a pawn to the field
             Field::addPawn(pawn);
@@ -383,6 +510,7 @@ namespace sista {
         void clearPawnsToSwap() { // clearPawnsToSwap - clear the pawnsToSwap
             Path::current_priority = 0;
             pawnsToSwap.clear();
+            pendingPaths.clear();
         }
 
         // ℹ️ - The following function calculates coordinates, but does not apply them to the pawns
@@ -396,34 +524,12 @@ namespace sista {
             if (!isOutOfBounds(y_, x_)) {
                 return Coordinates(y_, x_);
             } else if (effect == PACMAN_EFFECT) {
-                if (x_ < 0) {
-                    x_ = width-1-(x_ % width);
-                    if (x_ == width)
-                        x_ = width - 1;
-                } else if (x_ >= width) {
-                    x_ = abs(x_ % width);
-                }
-                if (y_ < 0) {
-                    y_ = height-1-(y_ % width);
-                    if (y_ == height)
-                        y_ = height -1;
-                } else if (y_ >= height) {
-                    y_ = abs(y_ % height);
-                }
-                return Coordinates(y_, x_);
+                return pawn->getCoordinates().wrapped(y, x, width, height);
             } else if (effect == MATRIX_EFFECT) {
-                short int y__ = y_;
-                short int x__ = x_;
-                if (x_ < 0) {
-                    x_ = width+(x_ % width);
-                    y_ = y__ + (short int)(x__ / width) - 1;
-                } else if (x_ >= width) {
-                    x_ %= width;
-                    y_ = y__ + (short int)(x__ / width);
-                }
-                // This [y_] could lead to a coordinate out of bounds...
-                if (!isOutOfBounds(y_, x_))
-                    return Coordinates(y_, x_);
+                Coordinates coordinates = pawn->getCoordinates().carried(y, x, width);
+                // This [y] could lead to a coordinate out of bounds...
+                if (!isOutOfBounds(coordinates))
+                    return coordinates;
                 else
                     throw std::range_error("Invalid Coordinates, the movement is not possible");
             } else {
@@ -434,78 +540,115 @@ namespace sista {
         void addPawnToSwap(Pawn* pawn, Coordinates& first) { // addPawnToSwap - add a pawn to the pawnsToSwap
             if (!isOutOfBounds(first)) {
                 Coordinates start = pawn->getCoordinates();
-                std::vector<Path>::iterator it = std::find_if(
-                    pawnsToSwap.begin(), pawnsToSwap.end(), [&](Path& path_) {
-                        return (path_.begin == first && path_.end == start);
-                    }
-                ); // Search for the opposite of the swap
-                if (it != pawnsToSwap.end()) { // If the opposite of the swap is found...
-                    swapTwoPawns(it->pawn, pawn); // Swap the pawns
-                    pawnsToSwap.erase(it);
+                std::size_t index = findPath(first, start); // Search for the opposite of the swap
+                if (index != pawnsToSwap.size()) { // If the opposite of the swap is found...
+                    swapTwoPawns(pawnsToSwap[index].pawn, pawn); // Swap the pawns
+                    removePath(index);
                 } else {
-                    pawnsToSwap.push_back(Path(start, first, pawn));
+                    pushPath(Path(start, first, pawn));
                 }
             }
         }
         void addPawnToSwap(Path& path) { // addPawnToSwap - add a pawn to the pawnsToSwap
             if (!isOutOfBounds(path.begin) && !isOutOfBounds(path.end)) {
-                std::vector<Path>::iterator it = std::find_if(
-                    pawnsToSwap.begin(), pawnsToSwap.end(), [&](Path& path_) {
-                        return path | path_;
-                    }
-                ); // Search for the opposite of the swap
-                if (it != pawnsToSwap.end()) { // If the opposite of the swap is found...
-                    swapTwoPawns(it->pawn, path.pawn); // Swap the pawns
-                    pawnsToSwap.erase(it);
+                // Search for the same or the opposite of the swap (see Path::operator|), the first one queued wins
+                std::size_t index = std::min(findPath(path.begin, path.end), findPath(path.end, path.begin));
+                if (index != pawnsToSwap.size()) { // If the opposite of the swap is found...
+                    swapTwoPawns(pawnsToSwap[index].pawn, path.pawn); // Swap the pawns
+                    removePath(index);
                 } else {
-                    pawnsToSwap.push_back(path);
+                    pushPath(path);
                 }
             }
         }
-        void simulateSwaps() { // simulateSwaps - simulate all the swaps in the pawnsToSwap
-            std::vector<std::vector<short int>> pawnsCount_ = pawnsCount; // Copy the pawnsCount
-            for (Path& path : pawnsToSwap) { // Simulate all the swaps in the pawnsToSwap
-                pawnsCount_[path.begin.y][path.begin.x]--; // Decrease the number of pawns at the begin of the path (because the pawn will be removed from there)
-                pawnsCount_[path.end.y][path.end.x]++; // Increase the number of pawns at the end of the path (because the pawn will be added there)
+        void simulateSwaps() { // simulateSwaps - simulate all the swaps in the pawnsToSwap, cancelling the ones which would stack pawns
+            pawnsToSwap.erase(std::remove_if(pawnsToSwap.begin(), pawnsToSwap.end(), [](Path& path) {
+                return path.pawn == nullptr;
+            }), pawnsToSwap.end()); // Drop the removed paths
+            std::sort(pawnsToSwap.begin(), pawnsToSwap.end()); // Sort the pawnsToSwap by priority
+
+            // Only the cells touched by the swaps are counted, so the cost depends on the swaps and not on the size of the field
+            std::unordered_map<Coordinates, SwapCell> cells;
+            cells.reserve(pawnsToSwap.size() * 2);
+            auto touch = [&](const Coordinates& coordinates) -> SwapCell& {
+                std::unordered_map<Coordinates, SwapCell>::iterator it = cells.find(coordinates);
+                if (it == cells.end())
+                    it = cells.emplace(coordinates, SwapCell{pawnsCount[coordinates.y][coordinates.x], {}}).first;
+                return it->second;
+            };
+            for (std::size_t i = 0; i < pawnsToSwap.size(); i++) { // Simulate all the swaps in the pawnsToSwap
+                touch(pawnsToSwap[i].begin).count--; // The pawn will be removed from the begin of the path
+                SwapCell& end = touch(pawnsToSwap[i].end);
+                end.count++; // The pawn will be added to the end of the path
+                end.arriving.push_back(i);
             }
 
-            std::sort(pawnsToSwap.begin(), pawnsToSwap.end()); // Sort the pawnsToSwap by priority
-            std::vector<Path>::iterator it = pawnsToSwap.begin();
-            Coord arrive_coord; // Coordinates of the cell with 2 or more pawns (so where a certain pawn arrived and should never be arrived at)
-            try {
-                while (true) {
-                    // Find the first cell with 2 or more pawns
-                    arrive_coord = firstInvalidCell(pawnsCount_); // throw std::runtime_error("No invalid cells found");
-                    Coordinates arrive_(arrive_coord); // Coordinates of the cell with 2 or more pawns (so where a certain pawn arrived and should never be arrived at)
-
-                    // Find a pawn that arrived at the cell with 2 or more pawns
-                    // Pawn* pawn = getPawn(arrive_); // NO! Swap weren't applied yet, so the pawn is still at the begin of the path
-                    pawnsCount_[arrive_.y][arrive_.x]--; // Decrease the number of pawns at the cell with 2 or more pawns (because the pawn will be removed from there)
-                    for (it = pawnsToSwap.begin(); it != pawnsToSwap.end(); it++) {
-                        if (it->end == arrive_) { // If the pawn arrived at the cell with 2 or more pawns
-                            pawnsCount_[it->begin.y][it->begin.x]++; // Increase the number of pawns at the begin of the path (because the pawn will be added there)
-                            pawnsToSwap.erase(it); // Remove the path from the pawnsToSwap (this movement can't be applied anymore)
-                            break;
-                        }
-                    }
-                } // This loop will be broken when the firstInvalidCell throws an exception
-            } catch (std::runtime_error& e) {
-                pawnsCount = pawnsCount_; // Apply the swaps
-                return; // No more invalid cells found
+            // Cells with 2 or more pawns (so where a certain pawn arrived and should never be arrived at)
+            std::vector<Coordinates> worklist;
+            for (std::pair<const Coordinates, SwapCell>& cell : cells)
+                if (cell.second.count >= 2)
+                    worklist.push_back(cell.first);
+            std::vector<bool> cancelled(pawnsToSwap.size(), false);
+            while (!worklist.empty()) {
+                SwapCell& cell = cells[worklist.back()];
+                worklist.pop_back();
+                // The arriving pawns are sent back to the begin of their path, by priority, until the cell is valid
+                while (cell.count >= 2 && cell.cancelled < cell.arriving.size()) {
+                    std::size_t index = cell.arriving[cell.cancelled++];
+                    cancelled[index] = true;
+                    cell.count--;
+                    SwapCell& begin = cells[pawnsToSwap[index].begin]; // Already touched by the path
+                    if (++begin.count == 2) // The pawn staying there could invalidate its begin cell
+                        worklist.push_back(pawnsToSwap[index].begin);
+                }
+                if (cell.count >= 2) // No path to cancel, the pawns were already stacked before the swaps
+                    cell.count = 1;
             }
+
+            // Remove the cancelled paths (these movements can't be applied anymore), keeping the priority order
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < pawnsToSwap.size(); i++)
+                if (!cancelled[i])
+                    pawnsToSwap[kept++] = pawnsToSwap[i];
+            pawnsToSwap.erase(pawnsToSwap.begin() + kept, pawnsToSwap.end());
+            indexPaths();
+            // Apply the swaps to the touched cells only
+            for (std::pair<const Coordinates, SwapCell>& cell : cells)
+                pawnsCount[cell.first.y][cell.first.x] = cell.second.count;
         }
         void applySwaps() {
-            simulateSwaps(); // This assures that the pawnsToSwap is valid
-
-            // The swaps can be applied as it stands
+            simulateSwaps(); // This assures that the pawnsToSwap is valid, and updates the pawnsCount
+
+            // The swaps can be applied as it stands, in two phases: every begin is emptied, then every end is filled
+            // Each phase writes one cell per path, so the rows are split among the threads and no cell is written twice
+            // The workers are kept for the life of the field, so a big applySwaps only wakes them
+            if (pawnsToSwap.size() >= PARALLEL_SWAPS && workers.empty()) {
+                std::size_t groups = std::min(threads, (unsigned)height);
+                for (std::size_t group = 1; group < groups; group++)
+                    workers.emplace_back(&SwappableField::work, this, group);
+            }
+            std::size_t groups = pawnsToSwap.size() >= PARALLEL_SWAPS ? workers.size() + 1 : 1;
+            std::vector<std::vector<Path*>> begins(groups), ends(groups); // begins[i], ends[i] - paths whose begin/end is in the i-th group of rows
             for (Path& path : pawnsToSwap) {
-                removePawn(path.pawn); // Remove the pawn from the begin of the path
-                path.pawn->setCoordinates(path.end); // Set the pawn's coordinates to the end of the path
-                addPawn(path.pawn); // Add the pawn to the end of the path
+                begins[path.begin.y * groups / height].push_back(&path);
+                ends[path.end.y * groups / height].push_back(&path);
             }
+            run(emptyBegins, begins);
+            run(fillEnds, ends); // Started only once all the begins are empty
+
+            // Redraw, all at once
+            for (Path& path : pawnsToSwap)
+                if (pawns[path.begin.y][path.begin.x] == nullptr && placeCursor(path.begin)) {
+                    ANSI::reset();
+                    std::cout << ' ';
+                }
+            for (Path& path : pawnsToSwap)
+                if (placeCursor(path.end))
+                    path.pawn->print();
+            if (drawing && !pawnsToSwap.empty())
+                std::cout << std::flush;
             clearPawnsToSwap();
         }
-
         void swapTwoPawns(Coordinates& first, Coordinates& second) {
             // Swap the coordinates of the two pawns (into the Pawn object)
             Pawn* first_ = getPawn(first);
@@ -530,13 +673,11 @@ namespace sista {
             second->setCoordinates(temp);
 
             // Draw the first pawn at the second pawn's coordinates
-            cursor.set(temp);
-            std::cout << ' ';
-            cursor.set(app);
-            first->print();
+            if (placeCursor(app))
+                first->print();
             // Draw the second pawn at the first pawn's coordinates
-            cursor.set(temp);
-            second->print();
+            if (placeCursor(temp))
+                second->print();
 
             // std::swap the pointers Pawn* in the pawns 2D-std::vector
             std::swap(
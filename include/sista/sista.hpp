@@ -5,4 +5,5 @@
 #include "coordinates.hpp" // Coord, Coordinates, <utility>
 #include "pawn.hpp" // Pawn
 #include "field.hpp" // Field, Path, SwappableField
-#include "cursor.hpp" // Cursor, clearScreen [cross-platform since v0.6.0]
\ No newline at end of file
+#include "cursor.hpp" // Cursor, clearScreen [cross-platform since v0.6.0]
+#include "viewport.hpp" // Viewport, terminalSize
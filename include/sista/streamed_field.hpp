@@ -0,0 +1,380 @@
+#pragma once
+
+#include <string> // std::string, std::to_string
+#include <vector> // std::vector
+#include <stdexcept> // std::runtime_error
+#include <list> // std::list
+#include <deque> // std::deque
+#include <unordered_set> // std::unordered_set
+#include <thread> // std::thread
+#include <mutex> // std::mutex, std::unique_lock
+#include <condition_variable> // std::condition_variable
+#include <fstream> // std::ifstream, std::ofstream
+#include <iterator> // std::istreambuf_iterator, std::prev
+#include <filesystem> // std::filesystem::create_directories, std::filesystem::directory_iterator
+#include <cstdio> // std::remove, std::sscanf
+#include "chunked_field.hpp" // ChunkedField, CHUNK_SIZE
+
+
+namespace sista {
+    // PawnFactory - creates the pawn stored in a chunk file, to restore the subclasses of Pawn
+    typedef Pawn* (*PawnFactory)(char symbol, Coordinates coordinates, ANSI::Settings settings);
+    Pawn* makePawn(char symbol, Coordinates coordinates, ANSI::Settings settings) { // The default PawnFactory
+        return new Pawn(symbol, coordinates, settings);
+    }
+
+    // StreamedField class - a ChunkedField which keeps at most a memory budget of chunks, the others are on disk
+    // The chunks far from the focus are written to <directory>/<y>_<x>.chunk by a background thread, least recently used first
+    // The chunks near the focus are read back in advance, so a lookup only waits for the disk if the chunk was not prefetched
+    // ⚠️ Evicting a chunk deletes its pawns, so the pawns which are referenced elsewhere must stay close to the focus
+    // ⚠️ A chunk whose write fails is put back in memory and focus() throws a std::runtime_error (see check())
+    // ⚠️ A chunk file which can't be decoded is left on disk and the chunk is empty, focus() throws a std::runtime_error too
+    class StreamedField : public ChunkedField {
+    private:
+        struct Job { // Job - work for the I/O thread
+            enum Kind {READ, WRITE, REMOVE} kind;
+            Coordinates chunk;
+            std::string bytes; // bytes - what is written [WRITE]
+            unsigned long long generation = 0; // generation - to know if the write is still the newest [WRITE]
+        };
+
+        std::string directory; // directory - where the chunk files are
+        std::size_t budget; // budget - maximum bytes of chunks in memory, the prefetched ones included (after focus())
+        PawnFactory factory;
+        unsigned short radius; // radius - chunks kept around the focus
+        std::list<Coordinates> recent; // recent - the chunks in memory, the most recently used first
+        std::unordered_map<Coordinates, std::list<Coordinates>::iterator> recentIndex; // recentIndex[chunk] - the chunk in recent
+        std::unordered_set<Coordinates> stored; // stored - the chunks which are on disk and not in memory
+        std::unordered_set<Coordinates> unreadable; // unreadable - the stored chunks whose file can't be decoded, they're not read again
+
+        // Shared with the I/O thread [mutex]
+        std::mutex mutex;
+        std::condition_variable wake; // wake - a job was queued or a read was done
+        std::deque<Job> jobs;
+        std::unordered_map<Coordinates, std::string> loaded; // loaded - chunks read in advance, waiting to be used (still on disk too)
+        std::size_t loadedBytes = 0; // loadedBytes - bytes of the chunks in loaded
+        std::unordered_set<Coordinates> reading; // reading - chunks being read in advance
+        std::unordered_map<Coordinates, std::pair<unsigned long long, std::string>> writing; // writing - chunks being written, still usable
+        std::vector<std::pair<Coordinates, unsigned long long>> failed; // failed - the writes which failed, their bytes stay in writing
+        std::string failure; // failure - why the last write or read failed, check() throws it
+        unsigned long long generation = 0;
+        bool busy = false; // busy - the I/O thread is doing a job
+        bool stopping = false;
+        std::thread worker;
+
+        std::string path(const Coordinates& chunk) {
+            return directory + "/" + std::to_string(chunk.y) + "_" + std::to_string(chunk.x) + ".chunk";
+        }
+        void work() { // The I/O thread, which never touches the chunks in memory
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [this]() {
+                    return stopping || !jobs.empty();
+                });
+                if (jobs.empty()) // stopping, and everything was written
+                    return;
+                Job job = std::move(jobs.front());
+                jobs.pop_front();
+                busy = true;
+                lock.unlock();
+                bool written = true;
+                if (job.kind == Job::READ) {
+                    std::string bytes = readFile(path(job.chunk));
+                    lock.lock();
+                    loadedBytes += bytes.size();
+                    loaded[job.chunk] = std::move(bytes);
+                    reading.erase(job.chunk);
+                } else if (job.kind == Job::WRITE) {
+                    std::ofstream file(path(job.chunk), std::ios::binary | std::ios::trunc);
+                    file.write(job.bytes.data(), job.bytes.size());
+                    file.close();
+                    written = !file.fail();
+                    lock.lock();
+                } else {
+                    std::remove(path(job.chunk).c_str());
+                    lock.lock();
+                }
+                if (job.kind == Job::WRITE) {
+                    std::unordered_map<Coordinates, std::pair<unsigned long long, std::string>>::iterator it = writing.find(job.chunk);
+                    if (it != writing.end() && it->second.first == job.generation) { // No newer write of the chunk was queued
+                        if (written) {
+                            writing.erase(it);
+                        } else { // Kept in writing, so that it's not lost until check() puts it back in memory
+                            failed.emplace_back(job.chunk, job.generation);
+                            failure = path(job.chunk) + " can't be written";
+                        }
+                    }
+                }
+                busy = false;
+                wake.notify_all();
+            }
+        }
+        void queue(Job job) { // [mutex]
+            jobs.push_back(std::move(job));
+            wake.notify_all();
+        }
+        static std::string readFile(const std::string& path_) {
+            std::ifstream file(path_, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        void touch(const Coordinates& chunk) { // touch - the chunk becomes the most recently used
+            std::unordered_map<Coordinates, std::list<Coordinates>::iterator>::iterator it = recentIndex.find(chunk);
+            if (it != recentIndex.end()) {
+                recent.splice(recent.begin(), recent, it->second);
+            } else {
+                recent.push_front(chunk);
+                recentIndex[chunk] = recent.begin();
+            }
+        }
+
+        // Chunk file: number of pawns [2 bytes], then for each pawn the cell, symbol, foreground, background and attribute [6 bytes]
+        std::string encode(Chunk& chunk) {
+            std::string bytes;
+            bytes.reserve(2 + 6*chunk.count);
+            bytes += (char)(chunk.count & 0xFF);
+            bytes += (char)(chunk.count >> 8);
+            for (std::size_t i = 0; i < chunk.occupied.size(); i++) {
+                std::uint64_t word = chunk.occupied[i];
+                while (word) {
+                    std::size_t cell = i*64 + Chunk::lowest(word);
+                    Pawn* pawn = chunk.cells[cell];
+                    ANSI::Settings settings = pawn->getSettings();
+                    bytes += (char)(cell & 0xFF);
+                    bytes += (char)(cell >> 8);
+                    bytes += pawn->getSymbol();
+                    bytes += (char)settings.foregroundColor;
+                    bytes += (char)settings.backgroundColor;
+                    bytes += (char)settings.attribute;
+                    word &= word - 1;
+                }
+            }
+            return bytes;
+        }
+        // install - decode a chunk and put it in memory, false if the bytes are truncated or malformed (nothing is installed then)
+        bool install(const Coordinates& chunk, const std::string& bytes) {
+            if (bytes.size() < 2)
+                return false;
+            const unsigned char* data = (const unsigned char*)bytes.data();
+            std::size_t count = data[0] | (data[1] << 8);
+            if (bytes.size() != 2 + 6*count)
+                return false;
+            for (std::size_t i = 0; i < count; i++) // Checked before any pawn is created
+                if ((std::size_t)(data[2 + 6*i] | (data[3 + 6*i] << 8)) >= CHUNK_SIZE*CHUNK_SIZE)
+                    return false;
+            std::unique_ptr<Chunk> chunk_(new Chunk());
+            for (std::size_t i = 0; i < count; i++) {
+                const unsigned char* pawn = data + 2 + 6*i;
+                std::size_t cell = pawn[0] | (pawn[1] << 8);
+                if (chunk_->cells[cell] != nullptr) // Twice the same cell, the first pawn is kept
+                    continue;
+                Coordinates coordinates(chunk.y*CHUNK_SIZE + cell/CHUNK_SIZE, chunk.x*CHUNK_SIZE + cell%CHUNK_SIZE);
+                chunk_->set(cell, factory((char)pawn[2], coordinates, ANSI::Settings((ANSI::ForegroundColor)pawn[3], (ANSI::BackgroundColor)pawn[4], (ANSI::Attribute)pawn[5])));
+            }
+            pawnsCount += chunk_->count;
+            chunks[chunk] = std::move(chunk_);
+            touch(chunk);
+            return true;
+        }
+        void evict(const Coordinates& chunk) { // evict - write the chunk to disk and free it
+            recentIndex.erase(chunk);
+            std::unordered_map<Coordinates, std::unique_ptr<Chunk>>::iterator it = chunks.find(chunk);
+            if (it == chunks.end()) // It was emptied and freed meanwhile
+                return;
+            std::string bytes = encode(*it->second);
+            pawnsCount -= it->second->count;
+            it->second->forEach([](Pawn* pawn) {
+                delete pawn;
+            });
+            chunks.erase(it);
+            stored.insert(chunk);
+            unreadable.erase(chunk); // Its file is replaced
+            std::lock_guard<std::mutex> lock(mutex);
+            writing[chunk] = std::make_pair(++generation, bytes);
+            Job job{Job::WRITE, chunk, std::move(bytes), generation};
+            queue(std::move(job));
+        }
+
+    protected:
+        void page(const Coordinates& chunk) override { // A chunk on disk is needed now
+            if (!stored.count(chunk) || unreadable.count(chunk))
+                return; // It's really empty, or its file is kept as it is
+            std::string bytes;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { // A read in advance which was not done yet is waited for
+                    return !reading.count(chunk);
+                });
+                std::unordered_map<Coordinates, std::string>::iterator it = loaded.find(chunk);
+                std::unordered_map<Coordinates, std::pair<unsigned long long, std::string>>::iterator written = writing.find(chunk);
+                if (it != loaded.end()) { // Prefetched in time, no I/O
+                    bytes = std::move(it->second);
+                    loadedBytes -= bytes.size();
+                    loaded.erase(it);
+                } else if (written != writing.end()) { // Evicted a moment ago, still in memory
+                    bytes = written->second.second;
+                } else { // Not prefetched, the simulation waits for the disk
+                    lock.unlock();
+                    bytes = readFile(path(chunk));
+                    lock.lock();
+                }
+            }
+            if (!install(chunk, bytes)) { // The file stays on disk, the error is thrown by the next check()
+                unreadable.insert(chunk);
+                std::lock_guard<std::mutex> lock(mutex);
+                failure = path(chunk) + " can't be read";
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            queue(Job{Job::REMOVE, chunk, "", 0}); // The chunk in memory is the only copy from now on
+            stored.erase(chunk);
+        }
+
+    public:
+        // StreamedField - at most budget_ bytes of chunks are kept in memory (prefetched or not), the ones in the radius_ (in chunks) around the focus are prefetched
+        // The chunk files already in directory_ are part of the field, so a world persists across runs
+        StreamedField(int width_, int height_, const std::string& directory_, std::size_t budget_, unsigned short radius_=2, PawnFactory factory_=makePawn):
+            ChunkedField(width_, height_), directory(directory_), factory(factory_), radius(radius_) {
+            budget = std::max(budget_, sizeof(Chunk));
+            std::filesystem::create_directories(directory);
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+                unsigned int y, x;
+                if (std::sscanf(entry.path().filename().string().c_str(), "%u_%u.chunk", &y, &x) == 2)
+                    stored.insert(Coordinates(y, x));
+            }
+            worker = std::thread(&StreamedField::work, this);
+        }
+        // ⚠️ The chunks whose write fails now are lost, call flush() before to know it
+        ~StreamedField() {
+            try {
+                flush();
+            } catch (std::runtime_error&) {}
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                wake.notify_all();
+            }
+            worker.join(); // After the queued writes
+        }
+
+        // focus - the chunks around coordinates are read in advance, then the least recently used chunks are evicted until the budget is met
+        // Meant to be called once per tick with the coordinates of the Builder (or of the viewport)
+        // ⚠️ This throws a std::runtime_error if some chunks couldn't be written since the last call (see check())
+        void focus(Coordinates coordinates) {
+            Coordinates center = chunkOf(coordinates);
+            int firstY = std::max(0, center.y - radius), lastY = std::min((height - 1) / CHUNK_SIZE, center.y + radius);
+            int firstX = std::max(0, center.x - radius), lastX = std::min((width - 1) / CHUNK_SIZE, center.x + radius);
+            for (int y = firstY; y <= lastY; y++)
+                for (int x = firstX; x <= lastX; x++)
+                    prefetch(Coordinates(y, x));
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks) // Used recently, so kept
+                if (chunk.first.y >= firstY && chunk.first.y <= lastY && chunk.first.x >= firstX && chunk.first.x <= lastX)
+                    touch(chunk.first);
+            for (std::list<Coordinates>::iterator it = recent.begin(); it != recent.end();) { // The chunks freed when emptied are forgotten
+                if (chunks.count(*it)) {
+                    it++;
+                } else {
+                    recentIndex.erase(*it);
+                    it = recent.erase(it);
+                }
+            }
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks) // The chunks created by addPawn() are not in recent yet
+                if (!recentIndex.count(chunk.first)) {
+                    recent.push_back(chunk.first);
+                    recentIndex[chunk.first] = std::prev(recent.end());
+                }
+            std::size_t prefetched; // The chunks read in advance for an older focus aren't needed anymore, they're still on disk
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::unordered_map<Coordinates, std::string>::iterator it = loaded.begin(); it != loaded.end();) {
+                    if (it->first.y >= firstY && it->first.y <= lastY && it->first.x >= firstX && it->first.x <= lastX) {
+                        it++;
+                    } else {
+                        loadedBytes -= it->second.size();
+                        it = loaded.erase(it);
+                    }
+                }
+                prefetched = loadedBytes;
+            }
+            while (chunks.size()*sizeof(Chunk) + prefetched > budget && !recent.empty()) {
+                Coordinates chunk = recent.back();
+                recent.pop_back();
+                evict(chunk);
+            }
+            check();
+        }
+        // check - the chunks whose write failed are put back in memory (their file is removed), then this throws a std::runtime_error
+        // It throws too if a chunk file couldn't be read since the last call
+        void check() {
+            std::vector<std::pair<Coordinates, std::string>> restored;
+            std::string error;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (failed.empty() && failure.empty())
+                    return;
+                for (std::pair<Coordinates, unsigned long long>& write : failed) {
+                    std::unordered_map<Coordinates, std::pair<unsigned long long, std::string>>::iterator it = writing.find(write.first);
+                    if (it == writing.end() || it->second.first != write.second) // Written again since then
+                        continue;
+                    if (stored.count(write.first)) { // Otherwise page() already put it back in memory
+                        restored.emplace_back(write.first, std::move(it->second.second));
+                        queue(Job{Job::REMOVE, write.first, "", 0});
+                    }
+                    writing.erase(it);
+                }
+                failed.clear();
+                error.swap(failure);
+            }
+            for (std::pair<Coordinates, std::string>& chunk : restored) {
+                stored.erase(chunk.first);
+                install(chunk.first, chunk.second);
+            }
+            throw std::runtime_error(error);
+        }
+        // prefetch - start reading the chunk from disk if it's there, without waiting
+        void prefetch(Coordinates chunk) {
+            if (!stored.count(chunk) || unreadable.count(chunk))
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (reading.count(chunk) || loaded.count(chunk) || writing.count(chunk))
+                return;
+            reading.insert(chunk);
+            queue(Job{Job::READ, chunk, "", 0});
+        }
+        // fall - ChunkedField::fall(), then the chunks below the pawns on the bottom row of a chunk are prefetched
+        template <typename Predicate>
+        std::size_t fall(Predicate falls) {
+            std::size_t moved = ChunkedField::fall(falls);
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks) {
+                bool bottom = false;
+                for (std::size_t cell = (CHUNK_SIZE - 1)*CHUNK_SIZE; cell < CHUNK_SIZE*CHUNK_SIZE && !bottom; cell++)
+                    bottom = chunk.second->cells[cell] != nullptr;
+                if (bottom)
+                    prefetch(Coordinates(chunk.first.y + 1, chunk.first.x));
+            }
+            return moved;
+        }
+        // flush - write all the chunks in memory to disk and wait for it, the field is left empty
+        // ⚠️ This throws a std::runtime_error if some chunks couldn't be written, they're left in memory (see check())
+        void flush() {
+            std::vector<Coordinates> resident;
+            for (std::pair<const Coordinates, std::unique_ptr<Chunk>>& chunk : chunks)
+                resident.push_back(chunk.first);
+            for (Coordinates& chunk : resident)
+                evict(chunk);
+            recent.clear();
+            recentIndex.clear();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() {
+                    return jobs.empty() && !busy;
+                });
+            }
+            check();
+        }
+
+        std::size_t getStoredCount() { // Number of chunks on disk and not in memory
+            return stored.size();
+        }
+    };
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <csignal> // std::signal, SIGWINCH, sig_atomic_t
+#include "coordinates.hpp" // Coord, Coordinates, <utility>
+#ifdef _WIN32
+    #include <windows.h> // GetConsoleScreenBufferInfo
+#else
+    #include <sys/ioctl.h> // ioctl, TIOCGWINSZ
+    #include <unistd.h> // STDOUT_FILENO
+#endif
+
+
+namespace sista {
+    volatile std::sig_atomic_t terminalResized = 1; // terminalResized - set by SIGWINCH, the first size is read anyway
+    #ifndef _WIN32
+        void onTerminalResize(int) { // SIGWINCH handler - only raises the flag, the size is read outside of the handler
+            terminalResized = 1;
+        }
+    #endif
+
+    // Reads the size of the terminal in characters, returns false if it can't be known (e.g. output redirected)
+    bool terminalSize(unsigned short& rows, unsigned short& columns) {
+        #ifdef _WIN32
+            CONSOLE_SCREEN_BUFFER_INFO info;
+            if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+                return false;
+            rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+            columns = info.srWindow.Right - info.srWindow.Left + 1;
+        #else
+            struct winsize size;
+            if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) < 0 || size.ws_row == 0 || size.ws_col == 0)
+                return false;
+            rows = size.ws_row;
+            columns = size.ws_col;
+        #endif
+        return true;
+    }
+
+    class Viewport { // Viewport class - the window of a Field which fits in the terminal
+    private:
+        int width; // Width of the field
+        int height; // Height of the field
+        unsigned short reservedRows; // Terminal rows taken by what's printed around the field
+        unsigned short reservedColumns; // Terminal columns taken by what's printed around the field
+        unsigned short top = 0; // First visible row of the field
+        unsigned short left = 0; // First visible column of the field
+        unsigned short rows; // Number of visible rows
+        unsigned short columns; // Number of visible columns
+        unsigned short margin; // Cells kept between the followed pawn and the edge of the window
+
+        static unsigned short clamp(int value, int low, int high) {
+            return (unsigned short)(value < low ? low : (value > high ? high : value));
+        }
+        void fit(Coordinates& coordinates) { // Move the window so that coordinates is visible, with a margin if possible
+            unsigned short marginY = std::min<unsigned short>(margin, (rows - 1) / 2);
+            unsigned short marginX = std::min<unsigned short>(margin, (columns - 1) / 2);
+            if (coordinates.y < top + marginY)
+                top = clamp(coordinates.y - marginY, 0, height - rows);
+            else if (coordinates.y + marginY >= top + rows)
+                top = clamp(coordinates.y + marginY - rows + 1, 0, height - rows);
+            if (coordinates.x < left + marginX)
+                left = clamp(coordinates.x - marginX, 0, width - columns);
+            else if (coordinates.x + marginX >= left + columns)
+                left = clamp(coordinates.x + marginX - columns + 1, 0, width - columns);
+        }
+
+    public:
+        Viewport(int width_, int height_, unsigned short reservedRows_, unsigned short reservedColumns_, unsigned short margin_=2):
+            width(width_), height(height_), reservedRows(reservedRows_), reservedColumns(reservedColumns_), rows(height_), columns(width_), margin(margin_) {
+            #ifndef _WIN32
+                std::signal(SIGWINCH, onTerminalResize);
+            #endif
+        }
+
+        // update - re-read the terminal size if it changed and keep coordinates in the window
+        // Returns true if the window moved or changed size, so everything on the screen must be printed again
+        bool update(Coordinates coordinates) {
+            unsigned short previousTop = top, previousLeft = left, previousRows = rows, previousColumns = columns;
+            #ifdef _WIN32
+                terminalResized = 1; // There's no SIGWINCH, so the size is polled
+            #endif
+            if (terminalResized) {
+                terminalResized = 0;
+                unsigned short terminalRows, terminalColumns;
+                if (terminalSize(terminalRows, terminalColumns)) {
+                    rows = clamp(terminalRows - reservedRows, 1, height);
+                    columns = clamp(terminalColumns - reservedColumns, 1, width);
+                } else { // Not a terminal, the whole field is shown
+                    rows = height;
+                    columns = width;
+                }
+                top = clamp(top, 0, height - rows);
+                left = clamp(left, 0, width - columns);
+            }
+            fit(coordinates);
+            return (top != previousTop || left != previousLeft || rows != previousRows || columns != previousColumns);
+        }
+
+        bool contains(Coordinates& coordinates) { // Check if the coordinates are in the window
+            return (coordinates.y >= top && coordinates.y < top + rows && coordinates.x >= left && coordinates.x < left + columns);
+        }
+        Coordinates toScreen(Coordinates& coordinates) { // Coordinates relative to the top-left corner of the window
+            return Coordinates(coordinates.y - top, coordinates.x - left);
+        }
+
+        unsigned short getTop() {
+            return top;
+        }
+        unsigned short getLeft() {
+            return left;
+        }
+        unsigned short getRows() {
+            return rows;
+        }
+        unsigned short getColumns() {
+            return columns;
+        }
+    };
+};
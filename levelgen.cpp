@@ -0,0 +1,173 @@
+#include "include/fullkning/state.hpp"
+#include "include/fullkning/solver.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// levelgen generates levels on all the cores, keeping those the solver wins through the rules within the budget of ticks
+// without the score going below the least one, and which meet the constraints; the same seed always gives the same levels,
+// whatever the number of threads
+// levelgen --out DIR [--count N] [--seed S] [--threads N] [--targets MIN-MAX] [--stones MIN-MAX] [--score MIN] [--budget TICKS]
+// The levels are written as DIR/1.level, DIR/2.level..., with their figures in DIR/index.csv
+const std::size_t ROUND = 4096; // Candidates of a round, the accepted ones are taken in order at its end
+
+struct Constraints {
+    unsigned targets[2] = {6, 24}; // targets - least and most targets
+    unsigned stones[2] = {0, 100}; // stones - least and most stones the best score takes
+    int score = 0; // score - least score, at the end of the solution
+    unsigned budget = 2000; // budget - ticks the solver has to win
+};
+
+struct Candidate {
+    std::vector<sista::Coordinates> targets;
+    solver::Solution solution;
+    bool accepted = false;
+};
+
+// generate - the candidate of the index, from its own generator so that it doesn't depend on the thread which makes it
+// The targets are stacked in the columns of a random span, some of them floating a few cells above the others
+void generate(Candidate& candidate, std::uint64_t seed, std::uint64_t index, const Constraints& constraints) {
+    std::seed_seq sequence{(std::uint32_t)seed, (std::uint32_t)(seed >> 32), (std::uint32_t)index, (std::uint32_t)(index >> 32)};
+    std::mt19937_64 random(sequence);
+    unsigned count = constraints.targets[0] + (unsigned)(random() % (constraints.targets[1] - constraints.targets[0] + 1));
+    unsigned short span = 3 + (unsigned short)(random() % (WIDTH - 2)); // Columns the targets are in
+    unsigned short left = (unsigned short)(random() % (WIDTH - span + 1));
+    double floating = std::uniform_real_distribution<double>(0, 0.5)(random); // Chance of a target to float
+    unsigned short tops[WIDTH]; // tops[x] - highest target of the column, HEIGHT if there's none
+    std::fill(tops, tops + WIDTH, (unsigned short)HEIGHT);
+    candidate.targets.clear();
+    for (unsigned attempt = 0; candidate.targets.size() < count && attempt < 8*count; attempt++) {
+        unsigned short x = left + (unsigned short)(random() % span);
+        unsigned short gap = std::uniform_real_distribution<double>(0, 1)(random) < floating ? 1 + (unsigned short)(random() % 3) : 0;
+        if (tops[x] < 3 + gap) // The column is full up to the builder
+            continue;
+        tops[x] -= 1 + gap;
+        candidate.targets.emplace_back(tops[x], x);
+    }
+}
+
+// check - solve the candidate and tell if it meets the constraints
+// Only the game the solver played counts: it gives up on the layouts it can't cover within the budgets
+void check(Candidate& candidate, const Constraints& constraints) {
+    rules::State game;
+    rules::start(game, candidate.targets);
+    unsigned stones = solver::stones(game);
+    candidate.accepted = false;
+    if (candidate.targets.size() < constraints.targets[0] || stones < constraints.stones[0] || stones > constraints.stones[1])
+        return;
+    short least = (short)std::max(constraints.score, (int)SHRT_MIN);
+    candidate.solution = solver::solve(game, constraints.budget, least);
+    candidate.accepted = candidate.solution.solved && candidate.solution.score >= constraints.score;
+}
+
+bool range(const char* text, unsigned (&values)[2]) { // range - "MIN-MAX" or a single value
+    int read = std::sscanf(text, "%u-%u", &values[0], &values[1]);
+    if (read == 1)
+        values[1] = values[0];
+    return read >= 1 && values[0] <= values[1];
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t count = 100;
+    std::uint64_t seed = 1;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string out; // out - given with --out, so that the levels made by hand are never written over by mistake
+    Constraints constraints;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        std::string argument = argv[i];
+        valid = i + 1 < argc;
+        if (argument == "--count" && valid)
+            count = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--seed" && valid)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (argument == "--threads" && valid)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (argument == "--targets" && valid)
+            valid = range(argv[++i], constraints.targets) && constraints.targets[0] > 0 && constraints.targets[1] <= WIDTH*(HEIGHT - 2);
+        else if (argument == "--stones" && valid)
+            valid = range(argv[++i], constraints.stones);
+        else if (argument == "--score" && valid)
+            constraints.score = std::atoi(argv[++i]);
+        else if (argument == "--budget" && valid)
+            constraints.budget = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (argument == "--out" && valid)
+            out = argv[++i];
+        else
+            valid = false;
+    }
+    if (!valid || out.empty()) {
+        std::cerr << "Usage: levelgen --out DIR [--count N] [--seed S] [--threads N] [--targets MIN-MAX] [--stones MIN-MAX] [--score MIN] [--budget TICKS]" << std::endl;
+        return 1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(out, error);
+    std::ofstream index(out + "/index.csv");
+    if (!index) {
+        std::cerr << "Could not create " << out << "/index.csv" << std::endl;
+        return 1;
+    }
+    index << "level,targets,stones,best_score,solution_ticks\n";
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Candidate> candidates(ROUND);
+    std::set<std::vector<unsigned short>> seen; // The layouts kept, a candidate made twice is kept once
+    std::size_t written = 0;
+    std::uint64_t generated = 0;
+    const std::uint64_t LIMIT = 1000 * ROUND; // Rounds after which the constraints are taken as impossible to meet
+    while (written < count && generated < LIMIT) {
+        std::atomic<std::size_t> next(0);
+        std::vector<std::thread> workers;
+        for (unsigned thread = 0; thread < threads; thread++)
+            workers.emplace_back([&]() {
+                for (std::size_t i = next.fetch_add(64); i < ROUND; i = next.fetch_add(64)) // 64 candidates at a time
+                    for (std::size_t j = i; j < std::min(ROUND, i + 64); j++) {
+                        generate(candidates[j], seed, generated + j, constraints);
+                        check(candidates[j], constraints);
+                    }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+        generated += ROUND;
+        for (Candidate& candidate : candidates) {
+            if (!candidate.accepted || written == count)
+                continue;
+            std::vector<unsigned short> layout;
+            for (const sista::Coordinates& coordinates : candidate.targets)
+                layout.push_back((unsigned short)(coordinates.y*WIDTH + coordinates.x));
+            std::sort(layout.begin(), layout.end());
+            if (!seen.insert(layout).second)
+                continue;
+            std::string name = std::to_string(++written);
+            std::ofstream file(out + "/" + name + ".level");
+            for (unsigned short cell : layout) // In the order of the rows, like levelmaker saves them
+                file << cell / WIDTH << ' ' << cell % WIDTH << '\n';
+            if (!file) {
+                std::cerr << "Could not write " << out << "/" << name << ".level" << std::endl;
+                return 1;
+            }
+            index << name << ',' << candidate.targets.size() << ',' << candidate.solution.stones << ',' << candidate.solution.score << ','
+                << candidate.solution.ticks << '\n';
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << written << " levels written to " << out << " out of " << generated << " candidates, in " << seconds << "s on " << threads << " threads" << std::endl;
+    if (written < count) {
+        std::cerr << "The constraints were met by too few candidates" << std::endl;
+        return 1;
+    }
+    return 0;
+}
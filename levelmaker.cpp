@@ -1,9 +1,15 @@
 #include "include/sista/sista.hpp"
+#include "include/fullkning/bitmap.hpp"
+#include "include/fullkning/allocations.hpp"
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #ifdef _WIN32
     #include <conio.h>
-#elif __linux__    
+#elif __linux__
     #include <unistd.h>
     #include <termios.h>
 
@@ -32,6 +38,7 @@
 
 #define WIDTH 10
 #define HEIGHT 20
+#define TOP 2 // First row where blocks can be placed, the ones above belong to the builder
 
 
 ANSI::Settings builder_style(
@@ -39,36 +46,232 @@ ANSI::Settings builder_style(
     ANSI::BackgroundColor::B_BLACK,
     ANSI::Attribute::REVERSE
 );
+ANSI::Settings mark_style(
+    ANSI::ForegroundColor::F_BLACK,
+    ANSI::BackgroundColor::B_CYAN,
+    ANSI::Attribute::BRIGHT
+);
 sista::Coordinates up(-1, 0), down(1, 0), left(0, -1), right(0, 1);
 
+// An Edit is the list of the cells an operation toggled, applying it again undoes it
+typedef std::vector<sista::Coordinates> Edit;
+
+// This namespace will contain the state of the editor
+namespace editor {
+    level::Bitmap* canvas; // The blocks of the level, one bit per cell
+    sista::Field* field; // The field, which only holds the builder
+    sista::Pawn* builder; // The builder, blocks are placed under it
+    sista::Cursor* cursor; // Used to draw the cells of the canvas
+    sista::Viewport* viewport; // The part of the canvas which fits in the terminal
+    std::ofstream journal; // Append-only log of the edits, replayed after a crash
+    std::vector<Edit> undo_stack; // Edits that can be undone
+    std::vector<Edit> redo_stack; // Edits that were undone and can be redone
+    bool marked = false; // This will tell if a corner was marked with M
+    sista::Coordinates mark; // The corner marked with M
+    level::Bitmap* clipboard = nullptr; // The region copied with C
+}
+
+// Returns the cell under the builder, where the operations are applied
+sista::Coordinates target() {
+    sista::Coordinates coordinates = editor::builder->getCoordinates();
+    coordinates.y++;
+    return coordinates;
+}
+bool isEditable(int y, int x) {
+    return !editor::canvas->isOutOfBounds(y, x) && y >= TOP;
+}
+
+void drawCell(unsigned short y, unsigned short x) {
+    sista::Coordinates coordinates(y, x);
+    if (editor::builder->getCoordinates() == coordinates)
+        return; // The builder is drawn over the cell
+    if (!editor::viewport->contains(coordinates))
+        return; // The cell is not visible
+    editor::cursor->set(editor::viewport->toScreen(coordinates));
+    if (editor::canvas->get(y, x)) {
+        builder_style.apply();
+        std::cout << '#';
+    } else if (editor::marked && editor::mark == coordinates) {
+        mark_style.apply();
+        std::cout << '+';
+    } else {
+        ANSI::reset();
+        std::cout << ' ';
+    }
+}
+
+// Toggles the cells of the edit, draws them and appends them to the journal
+void apply(Edit& edit) {
+    for (sista::Coordinates& coordinates : edit) {
+        editor::canvas->toggle(coordinates.y, coordinates.x);
+        drawCell(coordinates.y, coordinates.x);
+        editor::journal << coordinates.y << ' ' << coordinates.x << ' ';
+    }
+    editor::journal << '\n' << std::flush; // Each edit is on the disk as soon as it's done
+    std::cout << std::flush;
+}
+// Applies a new edit, which can then be undone
+void commit(Edit& edit) {
+    if (edit.empty())
+        return;
+    apply(edit);
+    editor::undo_stack.push_back(std::move(edit));
+    editor::redo_stack.clear();
+}
+void undo() {
+    if (editor::undo_stack.empty())
+        return;
+    apply(editor::undo_stack.back());
+    editor::redo_stack.push_back(std::move(editor::undo_stack.back()));
+    editor::undo_stack.pop_back();
+}
+void redo() {
+    if (editor::redo_stack.empty())
+        return;
+    apply(editor::redo_stack.back());
+    editor::undo_stack.push_back(std::move(editor::redo_stack.back()));
+    editor::redo_stack.pop_back();
+}
+
+// Adds to the edit the cell [y][x] if it's not already set to value
+void paint(Edit& edit, int y, int x, bool value) {
+    if (isEditable(y, x) && editor::canvas->get(y, x) != value)
+        edit.emplace_back(y, x);
+}
+void fillRectangle(sista::Coordinates first, sista::Coordinates second, bool value) {
+    Edit edit;
+    for (int y = std::min(first.y, second.y); y <= std::max(first.y, second.y); y++)
+        for (int x = std::min(first.x, second.x); x <= std::max(first.x, second.x); x++)
+            paint(edit, y, x, value);
+    commit(edit);
+}
+void drawLine(sista::Coordinates first, sista::Coordinates second) { // Bresenham's line
+    Edit edit;
+    int y = first.y, x = first.x;
+    int dy = -std::abs(second.y - y), dx = std::abs(second.x - x);
+    int step_y = y < second.y ? 1 : -1, step_x = x < second.x ? 1 : -1;
+    int error = dx + dy;
+    while (true) {
+        paint(edit, y, x, true);
+        if (y == second.y && x == second.x)
+            break;
+        if (2*error >= dy) {
+            error += dy;
+            x += step_x;
+        }
+        if (2*error <= dx) {
+            error += dx;
+            y += step_y;
+        }
+    }
+    commit(edit);
+}
+void copyRectangle(sista::Coordinates first, sista::Coordinates second) {
+    unsigned short top = std::min(first.y, second.y), left = std::min(first.x, second.x);
+    delete editor::clipboard;
+    editor::clipboard = new level::Bitmap(std::max(first.x, second.x) - left + 1, std::max(first.y, second.y) - top + 1);
+    for (unsigned short y = 0; y < editor::clipboard->getHeight(); y++)
+        for (unsigned short x = 0; x < editor::clipboard->getWidth(); x++)
+            editor::clipboard->set(y, x, editor::canvas->get(top + y, left + x));
+}
+void paste(sista::Coordinates corner) { // The copied region is pasted with its top-left corner on corner
+    if (editor::clipboard == nullptr)
+        return;
+    Edit edit;
+    for (unsigned short y = 0; y < editor::clipboard->getHeight(); y++)
+        for (unsigned short x = 0; x < editor::clipboard->getWidth(); x++)
+            paint(edit, corner.y + y, corner.x + x, editor::clipboard->get(y, x));
+    commit(edit);
+}
+
+void moveBuilder(sista::Coordinates& direction) {
+    sista::Coordinates from = editor::builder->getCoordinates();
+    sista::Coordinates to = from + direction;
+    if (editor::canvas->isOutOfBounds(to.y, to.x) || editor::canvas->get(to.y, to.x))
+        return; // The builder can't go over the blocks
+    editor::field->movePawnBy(editor::builder, direction);
+    drawCell(from.y, from.x); // The builder could have been over the mark or a pasted block
+}
+
+// Prints the visible part of the canvas and the help again
+void printScreen() {
+    sista::clearScreen();
+    editor::field->print('&');
+    for (int y = editor::viewport->getTop(); y < editor::viewport->getTop() + editor::viewport->getRows(); y++)
+        for (int x = editor::viewport->getLeft(); x < editor::viewport->getLeft() + editor::viewport->getColumns(); x++)
+            if (editor::canvas->get(y, x) || (editor::marked && editor::mark == sista::Coordinates(y, x)))
+                drawCell(y, x);
+    editor::cursor->set(editor::viewport->getRows() + 3, 0);
+    ANSI::reset();
+
+    std::cout << "\nUse {W, A, S, D}+ENTER to move the cursor" << std::endl;
+    std::cout << "Use {P, R}+ENTER to place and remove a block" << std::endl;
+    std::cout << "Use {M}+ENTER to mark a corner, then {F, E}+ENTER to fill and erase the rectangle, {L}+ENTER to draw a line" << std::endl;
+    std::cout << "Use {C, V}+ENTER to copy the marked rectangle and paste it" << std::endl;
+    std::cout << "Use {U, Y}+ENTER to undo and redo" << std::endl;
+    std::cout << "Use {Q}+ENTER to quit" << std::endl;
+}
+
+// Replays the journal left by a session which was not saved, returns the number of edits
+std::size_t recover(const std::string& journal_path) {
+    std::ifstream journal(journal_path);
+    std::size_t edits = 0;
+    std::string line;
+    while (std::getline(journal, line)) {
+        std::istringstream stream(line);
+        unsigned short y, x;
+        while (stream >> y >> x)
+            if (!editor::canvas->isOutOfBounds(y, x))
+                editor::canvas->toggle(y, x);
+        edits++;
+    }
+    return edits;
+}
+
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <level_name>" << std::endl;
+    allocations::Tag tag(allocations::EDITOR);
+    if (argc != 2 && argc != 4) {
+        std::cout << "Usage: " << argv[0] << " <level_name> [<width> <height>]" << std::endl;
         return 1;
     }
     std::string level_name = argv[1];
     std::string level_path = "levels/" + level_name + ".level"; // .level files are pairs of {y, x} coordinates
-    if (std::ifstream(level_path)) {
+    std::string journal_path = "levels/" + level_name + ".journal"; // .journal files are the unsaved edits
+    unsigned short width = argc == 4 ? std::atoi(argv[2]) : WIDTH;
+    unsigned short height = argc == 4 ? std::atoi(argv[3]) : HEIGHT;
+    if (width == 0 || height <= TOP) {
+        std::cout << "Invalid size" << std::endl;
+        return 1;
+    }
+    level::Bitmap canvas(width, height);
+    editor::canvas = &canvas;
+    bool recovering = (bool)std::ifstream(journal_path);
+    if (recovering) {
+        std::size_t edits = recover(journal_path);
+        std::cout << "Recovered " << edits << " edits from " << journal_path << std::endl;
+    } else if (std::ifstream(level_path)) {
         std::cout << "Level already exists" << std::endl;
         return 1;
     }
-    std::ofstream level_file(level_path);
-    if (!level_file) {
-        std::cout << "Could not create level file" << std::endl;
+    editor::journal.open(journal_path, std::ios::app);
+    if (!editor::journal) {
+        std::cout << "Could not create journal file" << std::endl;
         return 1;
     }
-    std::cout << "Level file created" << std::endl;
 
     sista::Cursor cursor_handler;
-    sista::Field field(WIDTH, HEIGHT);
-    sista::Pawn* builder = new sista::Pawn('$', sista::Coordinates(1, 5), builder_style);
+    sista::Field field(width, height);
+    sista::Viewport viewport(width, height, 11, 2); // Border and help take 11 rows, the border takes 2 columns
+    sista::Pawn* builder = new sista::Pawn('$', sista::Coordinates(1, width/2), builder_style);
+    editor::cursor = &cursor_handler;
+    editor::field = &field;
+    editor::viewport = &viewport;
+    editor::builder = builder;
+    field.setViewport(&viewport);
     field.addPawn(builder);
-    field.print('&');
-
-    std::cout << "\nUse {W, A, S, D}+ENTER to move the cursor" << std::endl;
-    std::cout << "Use {P, R}+ENTER to place and remove a block" << std::endl;
-    std::cout << "Use {Q}+ENTER to quit" << std::endl;
+    viewport.update(builder->getCoordinates());
+    printScreen();
 
     while (true) {
         #if _WIN32 or __linux__
@@ -82,75 +285,77 @@ int main(int argc, char* argv[]) {
         #endif
         switch (input) {
             case 'w': case 'W':
-                if (builder->getCoordinates().y > 0) {
-                    try {
-                        field.movePawnBy(builder, up);
-                    } catch (std::invalid_argument& e) {}
-                }
+                moveBuilder(up);
                 break;
             case 'a': case 'A':
-                if (builder->getCoordinates().x > 0) {
-                    try {
-                        field.movePawnBy(builder, left);
-                    } catch (std::invalid_argument& e) {}
-                }
+                moveBuilder(left);
                 break;
             case 's': case 'S':
-                if (builder->getCoordinates().y < HEIGHT - 1) {
-                    try {
-                        field.movePawnBy(builder, down);
-                    } catch (std::invalid_argument& e) {}
-                }
+                moveBuilder(down);
                 break;
             case 'd': case 'D':
-                if (builder->getCoordinates().x < WIDTH - 1) {
-                    try {
-                        field.movePawnBy(builder, right);
-                    } catch (std::invalid_argument& e) {}
-                }
+                moveBuilder(right);
                 break;
-            case 'p': case 'P': {
-                sista::Coordinates coordinates = builder->getCoordinates();
-                if (coordinates.y < 1)
-                    continue; // Do not place blocks on the first/second row
-                coordinates.y++;
-                if (coordinates.y < HEIGHT) {
-                    field.addPrintPawn(new sista::Pawn('#', coordinates, builder_style));
-                }
+            case 'p': case 'P': case 'r': case 'R': {
+                sista::Coordinates coordinates = target();
+                Edit edit;
+                paint(edit, coordinates.y, coordinates.x, input == 'p' || input == 'P');
+                commit(edit);
                 break;
             }
-            case 'r': case 'R': {
-                sista::Coordinates coordinates = builder->getCoordinates();
-                coordinates.y++;
-                if (coordinates.y < HEIGHT) {
-                    sista::Pawn* deleted = field.getPawn(coordinates);
-                    if (deleted != nullptr) {
-                        if (deleted->getSymbol() == '#') {
-                            field.removePawn(deleted);
-                            delete deleted;
-                            // Graphically remove the pawn
-                            cursor_handler.set(coordinates);
-                            ANSI::reset();
-                            std::cout << ' ';
-                        }
-                    }
-                }
+            case 'm': case 'M': {
+                sista::Coordinates previous = editor::mark;
+                bool was_marked = editor::marked;
+                editor::mark = target();
+                editor::marked = !editor::canvas->isOutOfBounds(editor::mark.y, editor::mark.x);
+                if (was_marked)
+                    drawCell(previous.y, previous.x);
+                if (editor::marked)
+                    drawCell(editor::mark.y, editor::mark.x);
                 break;
             }
-            case 'q': case 'Q':
-                for (int row = 0; row < HEIGHT; row++) {
-                    for (int col = 0; col < WIDTH; col++) {
-                        sista::Coordinates coordinates(row, col);
-                        if (field.getPawn(coordinates) != nullptr) {
-                            if (field.getPawn(coordinates)->getSymbol() == '#')
-                                level_file << coordinates.y << " " << coordinates.x << '\n';
-                        }
-                    }
+            case 'f': case 'F': case 'e': case 'E':
+                if (editor::marked && !editor::canvas->isOutOfBounds(target().y, target().x))
+                    fillRectangle(editor::mark, target(), input == 'f' || input == 'F');
+                break;
+            case 'l': case 'L':
+                if (editor::marked && !editor::canvas->isOutOfBounds(target().y, target().x))
+                    drawLine(editor::mark, target());
+                break;
+            case 'c': case 'C':
+                if (editor::marked && !editor::canvas->isOutOfBounds(target().y, target().x))
+                    copyRectangle(editor::mark, target());
+                break;
+            case 'v': case 'V':
+                paste(target());
+                break;
+            case 'u': case 'U':
+                undo();
+                break;
+            case 'y': case 'Y':
+                redo();
+                break;
+            case 'q': case 'Q': {
+                std::ofstream level_file(level_path);
+                if (!level_file) {
+                    std::cout << "Could not create level file, the edits are kept in " << journal_path << std::endl;
+                    return 1;
                 }
+                canvas.forEach([&](unsigned short y, unsigned short x) { // Only the set cells are visited
+                    level_file << y << " " << x << '\n';
+                });
                 level_file.close();
+                editor::journal.close();
+                std::remove(journal_path.c_str()); // The level is saved, so the journal is no more needed
                 std::cout << "Level saved" << std::endl;
                 field.reset();
+                delete editor::clipboard;
+                if (std::getenv("FULLKNING_ALLOCATIONS") != nullptr)
+                    allocations::summary(std::cout);
                 return 0;
+            }
         }
+        if (viewport.update(builder->getCoordinates())) // The builder went out of the screen or the terminal was resized
+            printScreen();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,100 @@
+#include "include/fullkning/level.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#define WIDTH 10
+#define HEIGHT 20
+
+
+// literal - text escaped to be pasted between the quotes of a C++ string literal (or in a comment)
+std::string literal(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            escaped += '\\', escaped += c;
+        else if (std::isprint((unsigned char)c))
+            escaped += c;
+        else { // An octal escape takes at most three digits, so it can't swallow the next character
+            const char* digits = "01234567";
+            unsigned char byte = (unsigned char)c;
+            escaped += {'\\', digits[byte >> 6], digits[(byte >> 3) & 7], digits[byte & 7]};
+        }
+    }
+    return escaped;
+}
+
+// levelpack turns every levels/*.level into constexpr data, so fullkning can start without touching the filesystem
+int main(int argc, char* argv[]) {
+    std::string levels_path = argc > 1 ? argv[1] : "levels";
+    std::string header_path = argc > 2 ? argv[2] : "include/fullkning/catalogue.hpp";
+
+    std::vector<std::string> names;
+    try {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(levels_path))
+            if (entry.is_regular_file() && entry.path().extension() == ".level")
+                names.push_back(entry.path().stem().string());
+    } catch (std::filesystem::filesystem_error& e) {
+        std::cerr << "Could not list " << levels_path << ": " << e.what() << std::endl;
+        return 1;
+    }
+    // Numeric names first and in order, so the catalogue reads like the level progression
+    std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+        if (a.size() != b.size())
+            return a.size() < b.size();
+        return a < b;
+    });
+
+    std::ofstream header(header_path);
+    if (!header) {
+        std::cerr << "Could not create " << header_path << std::endl;
+        return 1;
+    }
+    header << "// Generated by levelpack from " << literal(levels_path) << "/*.level, do not edit\n";
+    header << "#pragma once\n\n";
+    header << "#include \"level.hpp\" // Embedded\n\n\n";
+    header << "namespace level {\n";
+    std::vector<std::size_t> sizes;
+    std::vector<std::string> identifiers; // identifiers[i] - C++ name of the array of the i-th level
+    std::set<std::string> taken;
+    for (const std::string& name : names) {
+        std::string identifier = "level_";
+        for (char c : name)
+            identifier += std::isalnum((unsigned char)c) ? c : '_';
+        std::string unique = identifier;
+        for (unsigned suffix = 2; !taken.insert(unique).second; suffix++) // "a-b" and "a_b" both give level_a_b
+            unique = identifier + "_" + std::to_string(suffix);
+        identifiers.push_back(unique);
+    }
+    for (std::size_t i = 0; i < names.size(); i++) {
+        std::string path = levels_path + "/" + names[i] + ".level";
+        std::vector<sista::Coordinates> targets;
+        try {
+            targets = level::parseFile(path, WIDTH, HEIGHT, 2);
+        } catch (std::runtime_error& e) {
+            std::cerr << "Error while loading the level " << path << ": " << e.what() << std::endl;
+            return 1;
+        }
+        sizes.push_back(targets.size());
+        if (targets.empty()) // A zero-sized array is not valid C++, the size above tells it's a placeholder
+            targets.emplace_back(0, 0);
+        header << "    constexpr unsigned short " << identifiers[i] << "[][2] = {";
+        for (std::size_t j = 0; j < targets.size(); j++)
+            header << (j % 8 ? " " : "\n        ") << "{" << targets[j].y << ", " << targets[j].x << "},";
+        header << "\n    }; // " << literal(path) << "\n";
+    }
+    header << "\n    constexpr Embedded catalogue[] = {\n";
+    for (std::size_t i = 0; i < names.size(); i++)
+        header << "        {\"" << literal(names[i]) << "\", " << identifiers[i] << ", " << sizes[i] << "},\n";
+    if (names.empty())
+        header << "        {\"\", nullptr, 0},\n";
+    header << "    };\n";
+    header << "};\n";
+    header.close();
+
+    std::cout << names.size() << " levels packed into " << header_path << std::endl;
+    return 0;
+}
@@ -0,0 +1,678 @@
+#include "include/fullkning/level.hpp"
+#include "include/fullkning/timer_wheel.hpp"
+#include "include/fullkning/state.hpp"
+#include "include/fullkning/history.hpp"
+#include "include/fullkning/env.hpp"
+#include "include/fullkning/catalogue.hpp" // Generated by levelpack
+#include "include/sista/field.hpp"
+#include "include/sista/chunked_field.hpp"
+#include "include/sista/streamed_field.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// tests checks the pieces of the game whose behaviour is easy to get subtly wrong, without a terminal
+// tests [name...] - runs the tests whose name is given (all of them by default), prints the failed checks and exits with 1 if any
+unsigned failures = 0;
+
+// check - a condition the test expects, what is printed if it doesn't hold
+void check(bool condition, const std::string& what) {
+    if (condition)
+        return;
+    failures++;
+    std::printf("  failed: %s\n", what.c_str());
+}
+
+// parse - the targets of text fed to a level::Parser in chunks of size bytes (0 - in a single chunk)
+std::vector<sista::Coordinates> parse(const std::string& text, std::size_t size=0) {
+    level::Parser parser(10, 20, 2);
+    if (size == 0)
+        size = std::max<std::size_t>(text.size(), 1);
+    for (std::size_t offset = 0; offset < text.size(); offset += size)
+        parser.feed(text.data() + offset, std::min(size, text.size() - offset));
+    parser.finish();
+    return parser.getTargets();
+}
+std::string show(const std::vector<sista::Coordinates>& targets) { // show - the targets as "y x, y x..."
+    std::string text;
+    for (const sista::Coordinates& target : targets)
+        text += (text.empty() ? "" : ", ") + std::to_string(target.y) + " " + std::to_string(target.x);
+    return text;
+}
+// error - the line of the ParseError the text throws, 0 if it doesn't throw one
+std::size_t error(const std::string& text, std::size_t size=0) {
+    try {
+        parse(text, size);
+    } catch (level::ParseError& e) {
+        return e.line == 0 ? (std::size_t)-1 : e.line;
+    }
+    return 0;
+}
+
+void testParser() {
+    check(error("15 3\n\n  16 2\r\n19\t9 \n18 10\n") == 5, "a target out of the field throws on its line");
+    const std::string valid = "15 3\n\n  16 2\r\n19\t9 \n12 7\n16 2\n3 0";
+    const std::string expected = "15 3, 16 2, 19 9, 12 7, 3 0"; // The duplicate is dropped, the last line has no newline
+    check(show(parse(valid)) == expected, "a whole file gives " + expected + ", not " + show(parse(valid)));
+    for (std::size_t size = 1; size < valid.size(); size++) // Every token split at every chunk boundary
+        check(show(parse(valid, size)) == expected, "chunks of " + std::to_string(size) + " bytes give " + show(parse(valid, size)));
+    for (std::size_t split = 1; split < valid.size(); split++) { // Two chunks, split anywhere
+        level::Parser parser(10, 20, 2);
+        parser.feed(valid.data(), split);
+        parser.feed(valid.data() + split, valid.size() - split);
+        parser.finish();
+        check(show(parser.getTargets()) == expected, "a split at byte " + std::to_string(split) + " gives " + show(parser.getTargets()));
+    }
+    check(error("1\n", 1) == 1 && error("1") == 1 && error("4 5\n1") == 2, "a lone {y} throws, on the last line too");
+    check(error("12 5", 1) == 0 && show(parse("12 5", 1)) == "12 5", "the last token is flushed by finish() when it's split");
+    check(error("3 4 5\n") == 1, "a third value throws");
+    check(error("3 4\n3 x\n", 3) == 2, "a bad token split across chunks throws on its line");
+    check(error("1 4\n") == 1, "a target on the builder's rows throws");
+    check(error("3 -4\n") == 1 && error("3 4.0\n") == 1, "only unsigned integers are coordinates");
+    check(error("") == 0 && parse("\n\n").empty(), "an empty file has no targets");
+
+    const char* path = "tests.level.tmp"; // parseFile reads the file in one go, without a trailing newline too
+    std::ofstream(path, std::ios::binary) << "19 0\n4 9";
+    try {
+        check(show(level::parseFile(path, 10, 20, 2)) == "19 0, 4 9", "parseFile reads a file without a trailing newline");
+    } catch (std::runtime_error& e) {
+        check(false, std::string("parseFile threw ") + e.what());
+    }
+    std::remove(path);
+}
+
+void testCoordinates() {
+    const unsigned short values[] = {0, 1, 2, 255, 256, 4095, 32767, 32768, 65534, 65535};
+    for (unsigned short y : values)
+        for (unsigned short x : values) {
+            sista::Coordinates coordinates(y, x);
+            std::string name = "(" + std::to_string(y) + ", " + std::to_string(x) + ")";
+            check(sista::Coordinates::unpack(coordinates.pack()) == coordinates, name + " is unpacked as it was packed");
+            check(sista::Coordinates::fromIndex(coordinates.toIndex(65536), 65536) == coordinates, name + " comes back from its index");
+            for (unsigned short y_ : values)
+                for (unsigned short x_ : values) {
+                    sista::Coordinates other(y_, x_);
+                    if (coordinates != other && coordinates.pack() == other.pack())
+                        check(false, name + " packs as another cell");
+                    bool rowMajor = y < y_ || (y == y_ && x < x_);
+                    if ((coordinates < other) != rowMajor || (coordinates.toIndex(65536) < other.toIndex(65536)) != rowMajor)
+                        check(false, name + " isn't in row-major order with another cell");
+                }
+        }
+    const int width = 7, height = 5; // A field whose width isn't a power of 2, every cell once
+    std::vector<bool> seen(width * height, false);
+    for (unsigned short y = 0; y < height; y++)
+        for (unsigned short x = 0; x < width; x++) {
+            std::size_t index = sista::Coordinates(y, x).toIndex(width);
+            check(index < seen.size() && !seen[index], "each cell of a 7x5 field has its own index");
+            if (index < seen.size())
+                seen[index] = true;
+            check(sista::Coordinates::fromIndex(index, width) == sista::Coordinates(y, x), "the index of a cell of a 7x5 field is reversible");
+        }
+    check(std::hash<sista::Coordinates>()(sista::Coordinates(3, 4)) == sista::Coordinates(3, 4).pack(), "the hash of coordinates is their pack");
+}
+
+void testEnv() {
+    bool thrown = false;
+    try {
+        env::Batch batch(4, std::vector<rules::State>());
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown, "a Batch without levels throws");
+
+    // The same actions on a batch stepped by the calling thread and one stepped by the workers
+    const std::size_t size = PARALLEL_ENVS + 100;
+    std::vector<rules::State> levels = env::levels(level::catalogue);
+    env::Batch serial(size, levels, 5, 200, 1), parallel(size, levels, 5, 200, 4);
+    std::vector<unsigned char> actions(size), observations(size * OBSERVATION), others(size * OBSERVATION), dones(size), otherDones(size);
+    std::vector<short> rewards(size), otherRewards(size);
+    std::mt19937 random(11);
+    bool same = true;
+    for (int t = 0; t < 300; t++) {
+        for (unsigned char& action : actions)
+            action = random() % 6;
+        serial.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        parallel.step(actions.data(), others.data(), otherRewards.data(), otherDones.data());
+        same = same && observations == others && rewards == otherRewards && dones == otherDones;
+    }
+    check(same, "the workers step the games as the calling thread does");
+}
+
+void testTimers() {
+    // The wheel against a plain list of the timers, with delays which go past the span of both wheels (16*16 ticks)
+    // so that the timers of the top wheel alias the slot of the current tick and wait there for more turns
+    typedef TimerWheel<unsigned, 64> Wheel;
+    Wheel wheel;
+    wheel.clear(250); // Close to the turn of the top wheel
+    struct Expected {
+        unsigned id;
+        unsigned int due;
+        unsigned long long order; // order - when it was scheduled, the timers due at once fire in this order
+        bool cancelled;
+    };
+    std::vector<Expected> expected(64, Expected{0, 0, 0, true}); // expected[timer]
+    std::vector<bool> scheduled(64, false);
+    std::mt19937 random(5);
+    unsigned ids = 0;
+    unsigned long long order = 0;
+    auto delay = [&]() -> unsigned int {
+        unsigned roll = random() % 10;
+        return roll < 5 ? random() % 20 : (roll < 8 ? 240 + random() % 40 : 500 + random() % 800);
+    };
+    bool matches = true;
+    std::string first;
+    for (int t = 0; t < 5000 && matches; t++) {
+        while (random() % 3 == 0 && !wheel.isFull()) {
+            unsigned int delay_ = delay();
+            unsigned short timer = wheel.schedule(delay_, ids);
+            expected[timer] = Expected{ids++, wheel.getNow() + std::max(delay_, 1u), order++, false};
+            scheduled[timer] = true;
+        }
+        if (random() % 7 == 0) { // A timer is cancelled
+            unsigned short timer = random() % 64;
+            if (scheduled[timer] && !expected[timer].cancelled) {
+                wheel.cancel(timer);
+                expected[timer].cancelled = true;
+            }
+        }
+        std::vector<std::pair<unsigned long long, unsigned short>> due; // What the list says is due at the next tick, by order
+        for (unsigned short timer = 0; timer < 64; timer++)
+            if (scheduled[timer] && expected[timer].due == wheel.getNow() + 1) {
+                if (!expected[timer].cancelled)
+                    due.emplace_back(expected[timer].order, timer);
+                scheduled[timer] = false; // A cancelled one is released when due
+            }
+        std::sort(due.begin(), due.end());
+        std::vector<unsigned short> fired;
+        for (unsigned short timer = wheel.advance(); timer != Wheel::NONE; timer = wheel.next(timer))
+            fired.push_back(timer);
+        std::vector<unsigned short> wanted;
+        for (std::pair<unsigned long long, unsigned short>& timer : due)
+            wanted.push_back(timer.second);
+        if (fired != wanted) {
+            matches = false;
+            first = "tick " + std::to_string(wheel.getNow()) + ": " + std::to_string(fired.size()) + " timers fired instead of " + std::to_string(wanted.size());
+        }
+        for (unsigned short timer : fired) { // Each one comes back later or is done
+            if (wheel.get(timer) != expected[timer].id) {
+                matches = false;
+                first = "tick " + std::to_string(wheel.getNow()) + ": a timer lost its event";
+            }
+            if (random() % 2 == 0) {
+                unsigned int delay_ = delay();
+                wheel.reschedule(timer, delay_);
+                expected[timer].due = wheel.getNow() + std::max(delay_, 1u);
+                expected[timer].order = order++;
+                scheduled[timer] = true;
+            } else {
+                wheel.release(timer);
+            }
+        }
+    }
+    check(matches, "the wheel fires the timers when due and in order, " + first);
+    unsigned short used = 0;
+    for (unsigned short timer = 0; timer < 64; timer++)
+        used += scheduled[timer];
+    check(wheel.getUsed() == used, "the timers scheduled are counted");
+    check(wheel.isConsistent([](const unsigned&) {
+        return true;
+    }), "every timer is in one list after the turns of the wheel");
+}
+
+struct Silence { // Silence - what is printed to std::cout while it lives is discarded, the fields draw their cursor
+    std::ostringstream discarded;
+    std::streambuf* terminal;
+
+    Silence(): terminal(std::cout.rdbuf(discarded.rdbuf())) {}
+    ~Silence() {
+        std::cout.rdbuf(terminal);
+    }
+};
+
+// move - queue the pawn at [y][x] to move by (dy, dx)
+void move(sista::SwappableField& field, unsigned short y, unsigned short x, short dy, short dx) {
+    sista::Coordinates end(y + dy, x + dx);
+    field.addPawnToSwap(field.getPawn(y, x), end);
+}
+// pawn - a new pawn at [y][x] of the field, the symbol tells the pawns apart
+sista::Pawn* pawn(sista::SwappableField& field, char symbol, unsigned short y, unsigned short x) {
+    sista::Pawn* pawn_ = new sista::Pawn(symbol, sista::Coordinates(y, x), ANSI::Settings());
+    field.addPawn(pawn_);
+    return pawn_;
+}
+
+void testSwaps() {
+    Silence silence; // Destroyed after the fields
+    sista::SwappableField field(8, 8, 1);
+    field.setDrawing(false);
+    sista::Pawn* a = pawn(field, 'a', 0, 0);
+    sista::Pawn* b = pawn(field, 'b', 0, 2);
+    move(field, 0, 0, 0, 1);
+    move(field, 0, 2, 0, -1);
+    field.applySwaps();
+    check(a->getCoordinates() == sista::Coordinates(0, 0) && b->getCoordinates() == sista::Coordinates(0, 1), "of two pawns moving to the same cell, the first queued is sent back");
+
+    sista::Pawn* c = pawn(field, 'c', 2, 0);
+    sista::Pawn* d = pawn(field, 'd', 2, 1);
+    move(field, 2, 0, 0, 1);
+    move(field, 2, 1, 0, 1);
+    field.applySwaps();
+    check(c->getCoordinates() == sista::Coordinates(2, 1) && d->getCoordinates() == sista::Coordinates(2, 2), "a chain of moves is applied whole");
+    check(field.getPawn(2, 0) == nullptr && field.getPawn(2, 1) == c && field.getPawn(2, 2) == d, "the chain leaves the cells in order");
+    // The cell left by the chain counts one pawn once the two arrive, if the counts were changed twice it would hold both
+    sista::Pawn* e = pawn(field, 'e', 3, 0);
+    sista::Pawn* f = pawn(field, 'f', 1, 0);
+    move(field, 3, 0, -1, 0);
+    move(field, 1, 0, 1, 0);
+    field.applySwaps();
+    check(e->getCoordinates() == sista::Coordinates(3, 0) && f->getCoordinates() == sista::Coordinates(2, 0), "a freed cell takes a single pawn");
+
+    move(field, 2, 1, 0, 1); // c and d switch cells, through the index of the opposite paths
+    move(field, 2, 2, 0, -1);
+    field.applySwaps();
+    check(c->getCoordinates() == sista::Coordinates(2, 2) && d->getCoordinates() == sista::Coordinates(2, 1), "two pawns moving into each other switch");
+
+    // The same random moves on a field swapped by the calling thread and one swapped by the workers
+    const unsigned short size = 160;
+    sista::SwappableField serial(size, size, 1), parallel(size, size, 4);
+    serial.setDrawing(false);
+    parallel.setDrawing(false);
+    std::mt19937 random(7);
+    std::vector<sista::Pawn*> serialPawns, parallelPawns;
+    for (unsigned short y = 0; y < size; y++)
+        for (unsigned short x = 0; x < size; x++)
+            if (random() % 3 != 0) {
+                serialPawns.push_back(pawn(serial, '#', y, x));
+                parallelPawns.push_back(pawn(parallel, '#', y, x));
+            }
+    for (int round = 0; round < 4; round++) { // The workers are woken again at each round
+        std::vector<sista::Coordinates> before;
+        for (std::size_t i = 0; i < serialPawns.size(); i++) {
+            before.push_back(serialPawns[i]->getCoordinates());
+            sista::Coordinates end = before.back().saturated((short)(random() % 3) - 1, (short)(random() % 3) - 1, size, size);
+            serial.addPawnToSwap(serialPawns[i], end);
+            parallel.addPawnToSwap(parallelPawns[i], end);
+        }
+        serial.applySwaps();
+        parallel.applySwaps();
+        std::size_t moved = 0;
+        for (std::size_t i = 0; i < serialPawns.size(); i++)
+            moved += !(serialPawns[i]->getCoordinates() == before[i]);
+        check(moved >= PARALLEL_SWAPS, "round " + std::to_string(round) + " moves enough pawns to be swapped by the workers");
+    }
+    bool same = true;
+    for (std::size_t i = 0; i < serialPawns.size(); i++)
+        same = same && serialPawns[i]->getCoordinates() == parallelPawns[i]->getCoordinates();
+    check(same, "the workers move the pawns as the calling thread does");
+    std::size_t found = 0;
+    bool placed = true;
+    for (unsigned short y = 0; y < size; y++)
+        for (unsigned short x = 0; x < size; x++)
+            if (parallel.getPawn(y, x) != nullptr) {
+                found++;
+                placed = placed && parallel.getPawn(y, x)->getCoordinates() == sista::Coordinates(y, x);
+            }
+    check(found == parallelPawns.size() && placed, "no pawn is lost or stacked, and each one knows its cell");
+}
+
+void testChunks() {
+    Silence silence;
+    sista::ChunkedField field(65536, 65536); // The biggest field, where every unsigned short is a row
+    field.setDrawing(false);
+    sista::Pawn* pawn_ = new sista::Pawn('#', sista::Coordinates(0, CHUNK_SIZE - 1), ANSI::Settings());
+    field.addPawn(pawn_);
+    field.movePawnBy(pawn_, 0, 1); // Into the next chunk, the first one is freed
+    check(pawn_->getCoordinates() == sista::Coordinates(0, CHUNK_SIZE) && field.getChunksCount() == 1, "a pawn moved into another chunk frees the one it left");
+    bool thrown = false;
+    try {
+        field.movePawnBy(pawn_, -1, 0); // 0 - 1 would be the last row once narrowed
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown && pawn_->getCoordinates() == sista::Coordinates(0, CHUNK_SIZE), "a movement out of the top of the field throws and leaves the pawn");
+    std::size_t count = 0;
+    for (unsigned short x = 0; x < 200; x += 3)
+        field.addPawn(new sista::Pawn('#', sista::Coordinates(5, x), ANSI::Settings()));
+    field.forEach([&](sista::Pawn*) {
+        count++;
+    });
+    check(count == field.getPawnsCount() && count == 68, "forEach visits every pawn once");
+}
+
+void testStreamed() {
+    Silence silence;
+    const std::string directory = "tests.chunks.tmp";
+    std::filesystem::remove_all(directory);
+    {
+        sista::StreamedField field(CHUNK_SIZE*8, CHUNK_SIZE*8, directory, 1, 0); // A single chunk fits in memory
+        field.setDrawing(false);
+        for (unsigned short c = 0; c < 4; c++)
+            field.addPawn(new sista::Pawn('a' + c, sista::Coordinates(c*CHUNK_SIZE + 1, c*CHUNK_SIZE + 2), ANSI::Settings()));
+        field.flush();
+        check(field.getStoredCount() == 4 && field.getChunksCount() == 0, "flush() writes every chunk to disk");
+        sista::Pawn* pawn_ = field.getPawn(CHUNK_SIZE*2 + 1, CHUNK_SIZE*2 + 2);
+        check(pawn_ != nullptr && pawn_->getSymbol() == 'c', "a chunk on disk is read back when a cell of it is needed");
+
+        std::ofstream(directory + "/1_1.chunk", std::ios::binary | std::ios::trunc) << '\x01'; // Truncated
+        check(field.getPawn(CHUNK_SIZE + 1, CHUNK_SIZE + 2) == nullptr, "a chunk whose file is truncated is empty");
+        bool thrown = false;
+        try {
+            field.check();
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        check(thrown, "check() throws after a chunk file couldn't be read");
+        field.flush(); // The REMOVE jobs are done, a wrong one would have been queued before them
+        check(std::filesystem::exists(directory + "/1_1.chunk") && std::filesystem::file_size(directory + "/1_1.chunk") == 1, "the truncated file is left on disk");
+        check(field.getPawn(0, 0) == nullptr && field.getPawn(1, 2) != nullptr, "the other chunks are still there");
+    }
+    std::filesystem::remove_all(directory);
+}
+
+// baseline - the game as it was played with a Pawn per block on a sista::Field, before rules::State, to check that the rules didn't change it
+// The falling code is the one of the original game, only the printing is left out
+namespace baseline {
+    enum class BlockType {Virtual, Sand, Stone};
+    struct Block : public sista::Pawn {
+        BlockType type;
+        bool shadowing_virtual = false; // This will tell if the Block is over a VirtualBlock
+
+        Block(sista::Coordinates coordinates_, BlockType type_): sista::Pawn('#', coordinates_, ANSI::Settings()), type(type_) {}
+    };
+
+    struct Game {
+        sista::Field field;
+        unsigned short builder = WIDTH / 2; // The column of the builder, on row 1
+        short score;
+        bool stone_enabled = true;
+        short frame_countdown = 0;
+        BlockType hooked_block = BlockType::Sand;
+        Block* stone_falling = nullptr;
+        std::vector<Block*> sand_falling;
+        std::vector<sista::Coordinates> targets;
+        std::vector<Block*> unhooked; // unhooked - every block, the field doesn't delete the ones it lost
+
+        Game(const std::vector<sista::Coordinates>& targets_): field(WIDTH, HEIGHT), targets(targets_) {
+            field.setDrawing(false);
+            for (const sista::Coordinates& target : targets)
+                field.addPawn(new Block(target, BlockType::Virtual));
+            score = (short)(targets.size() * 3);
+        }
+        ~Game() {
+            for (int y = 0; y < HEIGHT; y++) // The field deletes the blocks on it, the others are deleted here
+                for (int x = 0; x < WIDTH; x++)
+                    if (std::find(unhooked.begin(), unhooked.end(), field.getPawn(y, x)) != unhooked.end())
+                        field.removePawn(field.getPawn(y, x));
+            for (Block* block : unhooked)
+                delete block;
+        }
+
+        void unhook() {
+            if (frame_countdown > 0)
+                return;
+            sista::Coordinates coordinates(2, builder);
+            if (hooked_block == BlockType::Sand) {
+                sand_falling.push_back(new Block(coordinates, BlockType::Sand));
+                unhooked.push_back(sand_falling.back());
+                field.addPawn(sand_falling.back());
+            } else {
+                if (!stone_enabled)
+                    return;
+                stone_falling = new Block(coordinates, BlockType::Stone);
+                unhooked.push_back(stone_falling);
+                field.addPawn(stone_falling);
+                stone_enabled = false;
+            }
+            score--;
+            frame_countdown = COOLDOWN;
+        }
+        // fall - one cell down for the block, false if it landed
+        bool fall(Block* block) {
+            sista::Coordinates one_down(1, 0);
+            try {
+                field.movePawnBy(block, one_down);
+                if (block->shadowing_virtual) {
+                    sista::Coordinates coordinates = block->getCoordinates();
+                    coordinates.y--;
+                    field.addPawn(new Block(coordinates, BlockType::Virtual));
+                    block->shadowing_virtual = false;
+                }
+            } catch (std::out_of_range& e) {
+                return false;
+            } catch (std::invalid_argument& e) {
+                sista::Coordinates coordinates = block->getCoordinates();
+                coordinates.y++;
+                Block* below = (Block*)field.getPawn(coordinates);
+                if (below->type != BlockType::Virtual)
+                    return false;
+                if (block->shadowing_virtual) { // The target below goes up under the block (smart swap)
+                    field.removePawn(block);
+                    field.movePawnFromTo(coordinates.y, coordinates.x, coordinates.y - 1, coordinates.x);
+                    block->setCoordinates(coordinates);
+                    field.addPawn(block);
+                } else {
+                    block->shadowing_virtual = true;
+                    field.removePawn(below);
+                    delete below;
+                    field.movePawnBy(block, one_down);
+                }
+            }
+            return true;
+        }
+        void tick() {
+            frame_countdown--;
+            std::vector<Block*> landed;
+            for (Block* block : sand_falling)
+                if (!fall(block))
+                    landed.push_back(block);
+            for (Block* block : landed)
+                sand_falling.erase(std::find(sand_falling.begin(), sand_falling.end(), block));
+            if (stone_falling != nullptr && !fall(stone_falling)) {
+                stone_falling = nullptr;
+                stone_enabled = true;
+            }
+        }
+        void press(char key) {
+            switch (key) {
+                case 'w':
+                    hooked_block = hooked_block == BlockType::Sand ? BlockType::Stone : BlockType::Sand;
+                    break;
+                case 'a':
+                    builder = (builder + WIDTH - 1) % WIDTH;
+                    break;
+                case 'd':
+                    builder = (builder + 1) % WIDTH;
+                    break;
+                case 's':
+                    unhook();
+                    break;
+                case ' ':
+                    stone_falling = nullptr;
+                    stone_enabled = true;
+                    break;
+            }
+        }
+        bool victory() {
+            for (sista::Coordinates& coordinates : targets)
+                if (field.getPawn(coordinates) != nullptr && ((Block*)field.getPawn(coordinates))->type == BlockType::Virtual)
+                    return false;
+            return true;
+        }
+        unsigned char cell(unsigned short y, unsigned short x) { // cell - the rules::Cell the baseline has on [y][x]
+            Block* block = (Block*)field.getPawn(y, x);
+            if (block == nullptr)
+                return rules::EMPTY;
+            if (block->type == BlockType::Virtual)
+                return rules::TARGET;
+            return (block->type == BlockType::Sand ? rules::SAND : rules::STONE) | (block->shadowing_virtual ? rules::TARGET : 0);
+        }
+    };
+};
+
+// differ - what the state and the baseline disagree on, empty if nothing
+std::string differ(rules::State& state, baseline::Game& game) {
+    for (unsigned short y = 2; y < HEIGHT; y++)
+        for (unsigned short x = 0; x < WIDTH; x++)
+            if (state.cells[y][x] != game.cell(y, x))
+                return "the cell " + std::to_string(y) + " " + std::to_string(x) + " is " + std::to_string(state.cells[y][x]) + " instead of " + std::to_string(game.cell(y, x));
+    if (state.score != game.score)
+        return "the score is " + std::to_string(state.score) + " instead of " + std::to_string(game.score);
+    if (state.builder != game.builder || state.stoneSelected != (game.hooked_block == baseline::BlockType::Stone))
+        return "the builder isn't the same";
+    if (rules::cooldown(state) != (unsigned)std::max<short>(game.frame_countdown, 0))
+        return "the cooldown is " + std::to_string(rules::cooldown(state)) + " instead of " + std::to_string(game.frame_countdown);
+    short stone = game.stone_falling == nullptr ? -1 : (short)game.stone_falling->getCoordinates().toIndex(WIDTH);
+    if (state.stone != stone)
+        return "the falling stone is on " + std::to_string(state.stone) + " instead of " + std::to_string(stone);
+    if (rules::victory(state) != game.victory())
+        return "the victory isn't the same";
+    return "";
+}
+
+void testRules() {
+    Silence silence;
+    std::mt19937 random(2024);
+    const char keys[] = {'w', 'a', 'd', 's', ' '};
+    for (std::size_t i = 0; i < sizeof(level::catalogue) / sizeof(level::catalogue[0]); i++) {
+        std::vector<sista::Coordinates> targets = level::fromEmbedded(level::catalogue[i]);
+        for (int recording = 0; recording < 20; recording++) {
+            // The recorded inputs: a key now and then, unhooks more often, as a player would
+            std::string inputs;
+            for (int t = 0; t < 400; t++) {
+                unsigned roll = random() % 10;
+                inputs += roll < 2 ? 's' : (roll < 4 ? keys[random() % 5] : '\0');
+            }
+            rules::State state;
+            rules::start(state, targets);
+            baseline::Game game(targets);
+            std::string difference = differ(state, game);
+            for (std::size_t t = 0; t < inputs.size() && difference.empty() && !game.victory(); t++) {
+                if (inputs[t] != '\0') {
+                    rules::press(state, inputs[t]);
+                    game.press(inputs[t]);
+                }
+                rules::tick(state);
+                game.tick();
+                difference = differ(state, game);
+                if (!difference.empty())
+                    difference = "level " + std::string(level::catalogue[i].name) + ", recording " + std::to_string(recording) + ", tick " + std::to_string(t + 1) + ": " + difference;
+            }
+            check(difference.empty(), difference);
+        }
+    }
+}
+
+void testHistory() {
+    rules::State state;
+    rules::start(state, level::fromEmbedded(level::catalogue[0]));
+    rules::History history;
+    std::vector<rules::State> marked; // marked[i] - the state when the i-th step was marked
+    std::mt19937 random(3);
+    const char keys[] = {'w', 'a', 'd', 's', 's', ' ', 'x'}; // 'x' isn't a key of the game
+    for (int move = 0; move < 300; move++) {
+        char key = keys[random() % 7];
+        rules::State before = state;
+        history.mark(state);
+        if (rules::press(state, key))
+            marked.push_back(before);
+        else
+            history.unmark();
+        for (unsigned ticks = random() % 4; ticks > 0; ticks--) // The blocks fall between the moves
+            rules::tick(state);
+    }
+    check(history.size() == marked.size(), "only the keys of the game are steps, " + std::to_string(history.size()) + " instead of " + std::to_string(marked.size()));
+
+    // Each undo goes back to the beginning of a step, the ticks after it included, even after ticks following an undo
+    bool same = true;
+    for (std::size_t undone = 0; !marked.empty() && undone < 150; undone++) {
+        if (undone % 10 == 5) { // Some ticks, then this step is undone again
+            for (int t = 0; t < 3; t++)
+                rules::tick(state);
+        }
+        history.undo(state);
+        same = same && std::memcmp(&state, &marked.back(), sizeof(rules::State)) == 0;
+        marked.pop_back();
+    }
+    check(same, "undo() gives back the state of each step");
+    check(history.size() == marked.size(), "each undo() drops a step");
+
+    rules::History short_(2);
+    rules::State first = state;
+    short_.mark(state);
+    rules::press(state, 's');
+    rules::tick(state);
+    rules::State second = state;
+    short_.mark(state);
+    rules::press(state, 'd');
+    rules::tick(state);
+    short_.mark(state);
+    rules::press(state, 'a');
+    check(short_.size() == 2 && short_.undo(state) && short_.undo(state) && !short_.undo(state), "at most depth steps are kept");
+    check(std::memcmp(&state, &second, sizeof(rules::State)) == 0 && std::memcmp(&state, &first, sizeof(rules::State)) != 0, "the oldest step is the one forgotten");
+
+    // Another thread changing its own state never appends to the journal of this one
+    rules::History journaled;
+    rules::State other;
+    rules::start(other, level::fromEmbedded(level::catalogue[1]));
+    other.builder = 0; // Its blocks fall where this state has none
+    state.builder = WIDTH - 1;
+    journaled.mark(state);
+    std::thread([&other]() {
+        for (int t = 0; t < 50; t++) {
+            rules::press(other, 's');
+            rules::tick(other);
+        }
+    }).join();
+    rules::State kept = state;
+    journaled.undo(state);
+    check(std::memcmp(&state, &kept, sizeof(rules::State)) == 0, "the changes of another thread aren't journaled");
+}
+
+struct Test {
+    const char* name;
+    void (*run)();
+};
+const Test TESTS[] = {
+    {"parser", testParser},
+    {"coordinates", testCoordinates},
+    {"timers", testTimers},
+    {"rules", testRules},
+    {"history", testHistory},
+    {"env", testEnv},
+    {"swaps", testSwaps},
+    {"chunks", testChunks},
+    {"streamed", testStreamed},
+};
+
+int main(int argc, char* argv[]) {
+    unsigned ran = 0;
+    for (const Test& test : TESTS) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++)
+            selected = selected || std::strcmp(argv[i], test.name) == 0;
+        if (!selected)
+            continue;
+        unsigned before = failures;
+        try {
+            test.run();
+        } catch (std::exception& e) {
+            check(false, std::string("threw ") + e.what());
+        }
+        ran++;
+        std::printf("%s %s\n", failures == before ? "ok    " : "FAILED", test.name);
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "No test is named so\n");
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}